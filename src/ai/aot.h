@@ -0,0 +1,34 @@
+#ifndef A3EM_AI_AOT_H
+#define A3EM_AI_AOT_H
+
+#include "./tf.h"
+
+// the model compiled ahead of time by aot.py into model_aot.cpp: the weights are const arrays, the activations
+// live at fixed offsets in one static buffer and the ops are straight-line kernel calls, so nothing is parsed,
+// planned or dispatched at run time. same contract as inference() and friends in tf.h.
+Tensor<f32, 1> aot_inference(const Tensor<f32, 2> &input);
+Status aot_inference_into(Tensor<f32, 1> &res, const Tensor<f32, 2> &input);
+Tensor<f32, 2> aot_input();
+Tensor<f32, 1> aot_output();
+Status aot_invoke();
+// the same model entered after its quantize op: the int8 input lives at the start of the activation buffer
+QTensor<i8, 2> aot_input_q8();
+Status aot_invoke_q8();
+u32 aot_output_size();
+// the activation buffer past the int8 input; nothing in it survives between invocations
+ArenaScratch aot_scratch();
+
+// the model run incrementally over feature columns (the input's cols axis) as they arrive. each pushed column goes
+// through the conv stack once and is kept only as long as a later column needs it, so a window that overlaps the
+// last one by all but aot_stream_hop() columns costs a hop's worth of convs instead of a whole window's. after a
+// reset, push a full window (the model's input width) and then hops of aot_stream_hop() columns; the output is then
+// the same bytes aot_inference() gives for the newest window. other push sizes are fine but the output is for
+// whichever window the last completed hop ended. columns have to be normalized consistently across windows for the
+// result to mean anything: normalize_for_learning() in util.h works on one window at a time, so it can't feed this as is.
+u32 aot_stream_hop();
+void aot_stream_reset();
+Status aot_stream_push(const Tensor<f32, 2> &columns);
+bool aot_stream_ready();
+Status aot_stream_output(Tensor<f32, 1> &res);
+
+#endif
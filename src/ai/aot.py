@@ -0,0 +1,588 @@
+import math
+import re
+import struct
+import sys
+
+# compiles the tflite model into straight-line c++ against kernels.h, writing model_aot.cpp.
+# usage: python3 aot.py [model.cpp | model.tflite] [model_aot.cpp]
+# only the standard library is needed; the flatbuffer is read directly.
+
+QUANTIZE, RESHAPE, CONV_2D, TRANSPOSE, LEAKY_RELU, FULLY_CONNECTED, DEQUANTIZE = 114, 22, 3, 39, 98, 9, 6
+FLOAT32, INT32, INT8 = 0, 2, 9
+ACT_NONE, ACT_RELU, ACT_RELU_N1_TO_1, ACT_RELU6 = 0, 1, 2, 3
+PADDING_SAME, PADDING_VALID = 0, 1
+ALIGN = 16
+
+class Table:
+    def __init__(self, buf, pos):
+        self.buf = buf
+        self.pos = pos
+        self.vtable = pos - struct.unpack_from('<i', buf, pos)[0]
+        self.vtable_len = struct.unpack_from('<H', buf, self.vtable)[0]
+
+    def field(self, i):
+        o = 4 + 2 * i
+        return struct.unpack_from('<H', self.buf, self.vtable + o)[0] if o < self.vtable_len else 0
+
+    def scalar(self, i, fmt, default = 0):
+        o = self.field(i)
+        return struct.unpack_from('<' + fmt, self.buf, self.pos + o)[0] if o else default
+
+    def ref(self, i):
+        o = self.field(i)
+        if not o: return None
+        p = self.pos + o
+        return p + struct.unpack_from('<I', self.buf, p)[0]
+
+    def table(self, i):
+        p = self.ref(i)
+        return Table(self.buf, p) if p is not None else None
+
+    def vector(self, i):
+        p = self.ref(i)
+        return (None, 0) if p is None else (p + 4, struct.unpack_from('<I', self.buf, p)[0])
+
+    def tables(self, i):
+        p, n = self.vector(i)
+        return [] if p is None else [Table(self.buf, p + 4 * k + struct.unpack_from('<I', self.buf, p + 4 * k)[0]) for k in range(n)]
+
+    def scalars(self, i, fmt):
+        p, n = self.vector(i)
+        return [] if p is None else list(struct.unpack_from(f'<{n}{fmt}', self.buf, p))
+
+    def string(self, i):
+        p, n = self.vector(i)
+        return '' if p is None else self.buf[p:p + n].decode()
+
+    def raw(self, i):
+        p, n = self.vector(i)
+        return b'' if p is None else self.buf[p:p + n]
+
+def load_model(path):
+    if path.endswith('.cpp'):
+        with open(path) as f:
+            text = f.read()
+        return bytes(int(x, 16) for x in re.findall(r'0x([0-9a-fA-F]{2})', text[text.index('{'):text.index('}')]))
+    with open(path, 'rb') as f:
+        return f.read()
+
+def f32(x):
+    return struct.unpack('<f', struct.pack('<f', x))[0]
+
+def tflm_round(x):
+    return int(math.floor(abs(x) + 0.5)) * (1 if x >= 0 else -1)
+
+# same as quantize_multiplier() in quant.h and QuantizeMultiplier() in tflm
+def quantize_multiplier(real):
+    if real == 0: return (0, 0)
+    m, shift = math.frexp(real)
+    q = tflm_round(m * (1 << 31))
+    if q == 1 << 31:
+        q //= 2
+        shift += 1
+    if shift < -31: return (0, 0)
+    return (q, shift)
+
+class Tensor:
+    def __init__(self, t, buffers):
+        self.name = t.string(3)
+        self.shape = t.scalars(0, 'i')
+        self.type = t.scalar(1, 'b')
+        self.data = buffers[t.scalar(2, 'I')].raw(0)
+        q = t.table(4)
+        self.scales = [f32(x) for x in q.scalars(2, 'f')] if q else []
+        self.zero_points = q.scalars(3, 'q') if q else []
+
+    def size(self):
+        return math.prod(self.shape)
+
+    def scale(self):
+        assert len(self.scales) == 1, f'{self.name} is not quantized per tensor'
+        return self.scales[0]
+
+    def zero_point(self):
+        return self.zero_points[0] if self.zero_points else 0
+
+    def ints(self):
+        return list(struct.unpack(f'<{len(self.data) // 4}i', self.data))
+
+class Op:
+    def __init__(self, code, inputs, outputs, options, leaky = None):
+        self.code = code
+        self.inputs = inputs
+        self.outputs = outputs
+        self.options = options
+        self.leaky = leaky  # a conv's fused leaky relu: its options, the conv's own output tensor and the relu's
+
+def parse(buf):
+    model = Table(buf, struct.unpack_from('<I', buf, 0)[0])
+    codes = [max(c.scalar(0, 'b'), c.scalar(3, 'i')) for c in model.tables(1)]
+    graphs = model.tables(2)
+    assert len(graphs) == 1, 'only single subgraph models are supported'
+    graph = graphs[0]
+    buffers = model.tables(4)
+    tensors = [Tensor(t, buffers) for t in graph.tables(0)]
+    ops = [Op(codes[o.scalar(0, 'I')], o.scalars(1, 'i'), o.scalars(2, 'i'), o.table(4)) for o in graph.tables(3)]
+    return tensors, ops, graph.scalars(1, 'i'), graph.scalars(2, 'i')
+
+def consumers(ops, t):
+    return [i for i, op in enumerate(ops) if t in op.inputs]
+
+# transpose(p) -> leaky relu -> transpose(p^-1) is the leaky relu alone, since it is elementwise
+def elide_transposes(tensors, ops, outputs):
+    res = []
+    i = 0
+    while i < len(ops):
+        a = ops[i]
+        if a.code == TRANSPOSE and i + 2 < len(ops) and ops[i + 1].code == LEAKY_RELU and ops[i + 2].code == TRANSPOSE:
+            b, c = ops[i + 1], ops[i + 2]
+            p, q = tensors[a.inputs[1]].ints(), tensors[c.inputs[1]].ints()
+            chained = b.inputs[0] == a.outputs[0] and c.inputs[0] == b.outputs[0]
+            private = all(len(consumers(ops, t)) == 1 and t not in outputs for t in (a.outputs[0], b.outputs[0]))
+            if chained and private and all(p[q[k]] == k for k in range(len(p))):
+                res.append(Op(LEAKY_RELU, [a.inputs[0]], c.outputs, b.options))
+                i += 3
+                continue
+        res.append(a)
+        i += 1
+    return res
+
+# conv -> leaky relu runs as one kernel, and so does conv -> transpose -> leaky relu with the transpose moved after the
+# pair (it only moves bytes). the conv output tensor keeps the conv's quantization for the fused kernel's sake.
+def fuse_leaky(tensors, ops, outputs):
+    def private(t): return len(consumers(ops, t)) == 1 and t not in outputs
+    res = []
+    i = 0
+    while i < len(ops):
+        a = ops[i]
+        b = ops[i + 1] if i + 1 < len(ops) else None
+        c = ops[i + 2] if i + 2 < len(ops) else None
+        if a.code == CONV_2D and b and b.inputs[0] == a.outputs[0] and private(a.outputs[0]):
+            if b.code == LEAKY_RELU:
+                res.append(Op(CONV_2D, a.inputs, b.outputs, a.options, (b.options, a.outputs[0], b.outputs[0])))
+                i += 2
+                continue
+            if b.code == TRANSPOSE and c and c.code == LEAKY_RELU and c.inputs[0] == b.outputs[0] and private(b.outputs[0]):
+                res.append(Op(CONV_2D, a.inputs, a.outputs, a.options, (c.options, a.outputs[0], c.outputs[0])))
+                res.append(Op(TRANSPOSE, b.inputs, c.outputs, b.options))
+                i += 3
+                continue
+        res.append(a)
+        i += 1
+    return res
+
+def leaky_multipliers(src, dst, options):
+    alpha = f32(options.scalar(0, 'f'))
+    identity = quantize_multiplier(f32(src.scale() / dst.scale()))
+    negative = quantize_multiplier(f32(f32(src.scale() * alpha) / dst.scale()))
+    return f'{src.zero_point()}, {dst.zero_point()}, {{ {identity[0]}, {identity[1]} }}, {{ {negative[0]}, {negative[1]} }}'
+
+# the quantized model input goes first, at offset 0, so the rest of the buffer is one piece for aot_scratch()
+def plan(tensors, ops, inputs, outputs, pinned):
+    # tensors that share storage (reshapes, in-place elementwise ops) point at one representative
+    owner = {}
+    def root(t):
+        while t in owner: t = owner[t]
+        return t
+    last_use = {}
+    for i, op in enumerate(ops):
+        for t in op.inputs:
+            if t >= 0: last_use[t] = i
+    for i, op in enumerate(ops):
+        src, dst = op.inputs[0], op.outputs[0]
+        if op.code == RESHAPE or (op.code == LEAKY_RELU and last_use.get(src) == i and src not in inputs):
+            owner[dst] = src
+
+    spans = {}
+    for i, op in enumerate(ops):
+        for t in op.inputs + op.outputs:
+            if t < 0 or tensors[t].data or tensors[t].type != INT8: continue
+            r = root(t)
+            first, last = spans.get(r, (i, i))
+            spans[r] = (min(first, i), max(last, i))
+    groups = sorted(spans, key = lambda r: (r != root(pinned), -tensors[r].size()))
+
+    # greedy first-fit by decreasing size, as plan_buffers() in planner.h does
+    offsets = {}
+    total = 0
+    for r in groups:
+        first, last = spans[r]
+        size = tensors[r].size()
+        live = [(offsets[o], tensors[o].size()) for o in offsets if spans[o][0] <= last and first <= spans[o][1]]
+        best = None
+        for start in [0] + [o + s for o, s in live]:
+            start = (start + ALIGN - 1) // ALIGN * ALIGN
+            if all(start + size <= o or o + s <= start for o, s in live) and (best is None or start < best): best = start
+        offsets[r] = best
+        total = max(total, best + size)
+    return { t: offsets[root(t)] for t in range(len(tensors)) if root(t) in offsets }, total
+
+def activation_range(act, out):
+    def q(v): return out.zero_point() + tflm_round(f32(v / out.scale()))
+    lo, hi = -128, 127
+    if act == ACT_RELU: lo = max(lo, q(0))
+    elif act == ACT_RELU6: lo, hi = max(lo, q(0)), min(hi, q(6))
+    elif act == ACT_RELU_N1_TO_1: lo, hi = max(lo, q(-1)), min(hi, q(1))
+    else: assert act == ACT_NONE, f'unsupported fused activation {act}'
+    return lo, hi
+
+def array(kind, name, values, per_line = 16):
+    lines = [', '.join(str(v) for v in values[i:i + per_line]) for i in range(0, len(values), per_line)]
+    return f'alignas(4) static const {kind} {name}[{len(values)}] = {{\n    ' + ',\n    '.join(lines) + ',\n};\n'
+
+def multipliers(name, ms):
+    return f'static const QMultiplier {name}[{len(ms)}] = {{ ' + ', '.join(f'{{ {m}, {s} }}' for m, s in ms) + ' };\n'
+
+# the conv stack redone a column at a time along the input's time axis (w after the input reshape). each conv keeps
+# its last k_w input columns in a ring and computes an output column once its stride says one is due; the columns
+# the last layer produces go to a ring as wide as its output, which the rest of the model (the head) runs over.
+# models without a leading run of convs that can work this way get entry points that refuse.
+def streaming(tensors, ops, layers, body, starts, at, x, q):
+    rows, cols = x.shape[1], x.shape[2]
+    run = []
+    i = 2 if len(ops) > 1 and ops[1].code == RESHAPE and tensors[ops[1].outputs[0]].shape == [1, rows, cols, 1] else len(ops)
+    prev = ops[1].outputs[0] if i == 2 else None
+    while i < len(ops) and ops[i].code in (CONV_2D, LEAKY_RELU) and ops[i].inputs[0] == prev:
+        if ops[i].code == CONV_2D and not layers[i]['columnwise']: break
+        run.append(i)
+        prev = ops[i].outputs[0]
+        i += 1
+    if not any(ops[j].code == CONV_2D for j in run) or i == len(ops):
+        refuse = '''THROW(std::runtime_error, "the model can't stream");
+    return take_error();'''
+        return f'''u32 aot_stream_hop() {{
+    return 0;
+}}
+void aot_stream_reset() {{}}
+Status aot_stream_push(const Tensor<f32, 2> &) {{
+    {refuse}
+}}
+bool aot_stream_ready() {{
+    return false;
+}}
+Status aot_stream_output(Tensor<f32, 1> &) {{
+    {refuse}
+}}
+'''
+
+    last = tensors[prev]
+    _, out_h, out_w, out_c = last.shape
+    column = max([layers[j]['out_col'] for j in run if ops[j].code == CONV_2D])
+    hop = 1
+    rings = []
+    steps = []
+    cur, spare = 'col', ['stream_a', 'stream_b']
+    for j in run:
+        op = ops[j]
+        if op.code == LEAKY_RELU:
+            n = tensors[op.outputs[0]].shape[1] * tensors[op.outputs[0]].shape[3]
+            steps.append(f'    leaky_relu_q8({cur}, {cur}, {n}, {layers[j]["args"]});')
+            continue
+        l = layers[j]
+        out = spare[0] if cur != spare[0] else spare[1]
+        if l['k_w'] == 1 and l['stride_w'] == 1:
+            steps.append(f'    {{\n        const i8 *const in[1] = {{ {cur} }};\n        {l["column"]}({out}, in, {l["call"]});\n    }}')
+        else:
+            r, k, st = len(rings), l['k_w'], l['stride_w']
+            rings.append(f'static i8 stream_ring{r}[{k}][{l["in_col"]}];\n')
+            cols_in = ', '.join(f'stream_ring{r}[(seen - {k - c}) % {k}]' for c in range(k))
+            steps.append(f'    std::memcpy(stream_ring{r}[stream_seen[{r}] % {k}], {cur}, {l["in_col"]});\n'
+                         f'    if (++stream_seen[{r}] < {k} || (stream_seen[{r}] - {k}) % {st} != 0) return;\n'
+                         f'    {{\n        const u32 seen = stream_seen[{r}];\n        const i8 *const in[{k}] = {{ {cols_in} }};\n'
+                         f'        {l["column"]}({out}, in, {l["call"]});\n    }}')
+            hop *= st
+        cur = out
+    tail = body[starts[i]:]
+
+    return f'''// the conv stack a column at a time: a ring of input columns per strided conv, the newest {out_w} output columns
+{"".join(rings)}static u32 stream_seen[{max(len(rings), 1)}];
+alignas(4) static i8 stream_a[{column}], stream_b[{column}];
+static i8 stream_last[{out_w}][{out_h * out_c}];
+static u32 stream_done;
+
+static void stream_column(const i8 *col) {{
+{chr(10).join(steps)}
+    std::memcpy(stream_last[stream_done % {out_w}], {cur}, {out_h * out_c});
+    ++stream_done;
+}}
+
+// the newest window's last activation put back in nhwc order, then the rest of the model as usual
+static void stream_head(f32 *y) {{
+    i8 *const t = {at(prev)};
+    for (u32 x = 0; x < {out_w}; ++x) {{
+        const i8 *col = stream_last[(stream_done - {out_w} + x) % {out_w}];
+        for (u32 h = 0; h < {out_h}; ++h) std::memcpy(t + (h * {out_w} + x) * {out_c}, col + h * {out_c}, {out_c});
+    }}
+{chr(10).join(tail)}
+}}
+
+u32 aot_stream_hop() {{
+    return {hop};
+}}
+
+void aot_stream_reset() {{
+    for (u32 &s : stream_seen) s = 0;
+    stream_done = 0;
+}}
+
+Status aot_stream_push(const Tensor<f32, 2> &columns) {{
+    StageScope stage(STAGE_INFERENCE);
+    if (columns.dim<0>() != {rows}) {{
+        THROW(std::runtime_error, "input wrong shape");
+        return take_error();
+    }}
+    i8 col[{rows}];
+    for (u32 c = 0; c < columns.dim<1>(); ++c) {{
+        for (u32 r = 0; r < {rows}; ++r) quantize_q8(col + r, &columns(r, c), 1, {q.scale()!r}f, {q.zero_point()});
+        stream_column(col);
+    }}
+    return Status{{ nullptr }};
+}}
+
+bool aot_stream_ready() {{
+    return stream_done >= {out_w};
+}}
+
+Status aot_stream_output(Tensor<f32, 1> &res) {{
+    StageScope stage(STAGE_INFERENCE);
+    if (!aot_stream_ready()) {{
+        THROW(std::runtime_error, "no complete window streamed yet");
+        return take_error();
+    }}
+    if (res.dim<0>() != {tensors[ops[-1].outputs[0]].shape[1]}) {{
+        THROW(std::runtime_error, "output wrong shape");
+        return take_error();
+    }}
+    stream_head(res.row(0));
+    return Status{{ nullptr }};
+}}
+'''
+
+def generate(source, buf):
+    tensors, ops, inputs, outputs = parse(buf)
+    assert len(inputs) == 1 and len(outputs) == 1, 'only single input, single output models are supported'
+    x, y = tensors[inputs[0]], tensors[outputs[0]]
+    assert x.type == FLOAT32 and len(x.shape) == 3 and x.shape[0] == 1, 'model input must be f32 [1, rows, cols]'
+    assert y.type == FLOAT32 and len(y.shape) == 2 and y.shape[0] == 1, 'model output must be f32 [1, n]'
+
+    assert ops[0].code == QUANTIZE and ops[0].inputs[0] == inputs[0], 'the model has to start by quantizing its input'
+    q = tensors[ops[0].outputs[0]]
+    ops = fuse_leaky(tensors, elide_transposes(tensors, ops, outputs), outputs)
+    offsets, arena_size = plan(tensors, ops, inputs, outputs, ops[0].outputs[0])
+    assert offsets[ops[0].outputs[0]] == 0
+    scratch_offset = (q.size() + ALIGN - 1) // ALIGN * ALIGN
+
+    consts = []
+    head = []
+    body = []
+    starts = {}  # op index -> its first line in body
+    layers = {}  # op index -> what streaming needs to redo it a column at a time
+    def at(t): return f'arena + {offsets[t]}' if offsets[t] else 'arena'
+
+    for i, op in enumerate(ops):
+        src, dst = tensors[op.inputs[0]], tensors[op.outputs[0]]
+        if op.code == QUANTIZE:
+            assert i == 0 and dst.type == INT8, 'quantize is only supported on the model input'
+            rows, cols = x.shape[1], x.shape[2]
+            head.append(f'    for (u32 i = 0; i < {rows}; ++i) quantize_q8({at(op.outputs[0])} + i * {cols}, x.row(i), {cols}, {dst.scale()!r}f, {dst.zero_point()});')
+            continue
+        starts[i] = len(body)
+        body.append(f'    // {dst.name}')
+        if op.code == DEQUANTIZE:
+            assert op.outputs[0] == outputs[0] and src.type == INT8, 'dequantize is only supported on the model output'
+            body.append(f'    dequantize_q8(y, {at(op.inputs[0])}, {y.shape[1]}, {src.scale()!r}f, {src.zero_point()});')
+        elif op.code == RESHAPE:
+            body.append('    // reshape: same bytes, nothing to do')
+        elif op.code == CONV_2D:
+            f, b = tensors[op.inputs[1]], tensors[op.inputs[2]] if len(op.inputs) > 2 and op.inputs[2] >= 0 else None
+            if op.leaky: dst = tensors[op.leaky[1]]
+            padding, stride_w, stride_h = op.options.scalar(0, 'b'), op.options.scalar(1, 'i'), op.options.scalar(2, 'i')
+            act, dilation_w, dilation_h = op.options.scalar(3, 'b'), op.options.scalar(4, 'i', 1), op.options.scalar(5, 'i', 1)
+            _, in_h, in_w, in_c = src.shape
+            _, out_h, out_w, out_c = dst.shape
+            _, k_h, k_w, _ = f.shape
+            pad_h = pad_w = 0
+            if padding == PADDING_SAME:
+                pad_h = max(0, ((out_h - 1) * stride_h + (k_h - 1) * dilation_h + 1 - in_h) // 2)
+                pad_w = max(0, ((out_w - 1) * stride_w + (k_w - 1) * dilation_w + 1 - in_w) // 2)
+            lo, hi = activation_range(act, dst)
+            scales = f.scales if len(f.scales) == out_c else f.scales * out_c
+            ms = [quantize_multiplier(src.scale() * s / dst.scale()) for s in scales]
+
+            consts.append(array('i8', f'conv{i}_filter', list(struct.unpack(f'<{len(f.data)}b', f.data))))
+            if b: consts.append(array('i32', f'conv{i}_bias', b.ints(), 8))
+            consts.append(multipliers(f'conv{i}_mult', ms))
+            consts.append(f'static constexpr QConv2D conv{i} = {{ {in_h}, {in_w}, {in_c}, {out_h}, {out_w}, {out_c}, {k_h}, {k_w}, {stride_h}, {stride_w}, '
+                          f'{dilation_h}, {dilation_w}, {pad_h}, {pad_w}, {src.zero_point()}, {dst.zero_point()}, {lo}, {hi} }};\n')
+            bias = f'conv{i}_bias' if b else 'nullptr'
+            call, kind = f'conv{i}_filter, {bias}, conv{i}_mult, conv{i}', ''
+            if op.leaky:
+                consts.append(f'static constexpr QLeakyRelu conv{i}_leaky = {{ {leaky_multipliers(dst, tensors[op.leaky[2]], op.leaky[0])} }};\n')
+                call, kind = f'{call}, conv{i}_leaky', '_leaky'
+            layers[i] = dict(in_col = in_h * in_c, out_col = out_h * out_c, k_w = k_w, stride_w = stride_w,
+                             columnwise = pad_w == 0 and dilation_w == 1, call = call, column = f'conv2d_column{kind}_q8')
+            body.append(f'    conv2d{kind}_q8({at(op.outputs[0])}, {at(op.inputs[0])}, {call});')
+        elif op.code == LEAKY_RELU:
+            layers[i] = dict(args = leaky_multipliers(src, dst, op.options))
+            body.append(f'    leaky_relu_q8({at(op.outputs[0])}, {at(op.inputs[0])}, {src.size()}, {layers[i]["args"]});')
+        elif op.code == TRANSPOSE:
+            perm = tensors[op.inputs[1]].ints()
+            assert len(perm) <= 4, 'transpose supports up to 4 dimensions'
+            pad = 4 - len(perm)
+            dims = [1] * pad + src.shape
+            perm = list(range(pad)) + [p + pad for p in perm]
+            body.append(f'    transpose_q8({at(op.outputs[0])}, {at(op.inputs[0])}, {{ {", ".join(map(str, dims))} }}, {{ {", ".join(map(str, perm))} }});')
+        elif op.code == FULLY_CONNECTED:
+            w, b = tensors[op.inputs[1]], tensors[op.inputs[2]] if len(op.inputs) > 2 and op.inputs[2] >= 0 else None
+            act = op.options.scalar(0, 'b') if op.options else ACT_NONE
+            out_n, in_n = w.shape
+            assert src.size() == in_n, 'fully connected input must be a single row'
+            lo, hi = activation_range(act, dst)
+            m = quantize_multiplier(f32(src.scale() * w.scale()) / dst.scale())
+
+            consts.append(array('i8', f'fc{i}_weights', list(struct.unpack(f'<{len(w.data)}b', w.data))))
+            if b: consts.append(array('i32', f'fc{i}_bias', b.ints(), 8))
+            bias = f'fc{i}_bias' if b else 'nullptr'
+            body.append(f'    fully_connected_q8({at(op.outputs[0])}, {at(op.inputs[0])}, fc{i}_weights, {bias}, {in_n}, {out_n}, '
+                        f'{src.zero_point()}, {w.zero_point()}, {dst.zero_point()}, {{ {m[0]}, {m[1]} }}, {lo}, {hi});')
+        else:
+            raise RuntimeError(f'unsupported op {op.code} ({dst.name})')
+
+    rows, cols, n = x.shape[1], x.shape[2], y.shape[1]
+    stream = streaming(tensors, ops, layers, body, starts, at, x, q)
+    return f'''// generated by aot.py from {source}, do not edit
+#include <cstring>
+
+#include "./aot.h"
+#include "./kernels.h"
+#include "./pool.h"
+
+{"".join(consts)}
+// the model needs {arena_size} bytes; builds can make it larger so the frontend plan fits in the scratch
+#ifndef AOT_ARENA_SIZE
+#define AOT_ARENA_SIZE {arena_size}
+#endif
+static_assert(AOT_ARENA_SIZE >= {arena_size}, "AOT_ARENA_SIZE too small for the model");
+
+constexpr u32 aot_arena_size = AOT_ARENA_SIZE;
+alignas(TENSOR_ALIGN) static i8 arena[aot_arena_size];
+alignas(TENSOR_ALIGN) static f32 input[{rows} * {cols}];
+static f32 output[{n}];
+
+static void run_quantized(f32 *y) {{
+{chr(10).join(body)}
+}}
+
+static void run(const Tensor<f32, 2> &x, f32 *y) {{
+{chr(10).join(head)}
+    run_quantized(y);
+}}
+
+u32 aot_output_size() {{
+    return {n};
+}}
+
+// everything after the quantized input, which the frontend fills while it works in the scratch
+ArenaScratch aot_scratch() {{
+    return {{ reinterpret_cast<u8*>(arena) + {scratch_offset}, aot_arena_size - {scratch_offset} }};
+}}
+
+Tensor<f32, 2> aot_input() {{
+    return {{ input, nullptr, {rows}, {cols} }};
+}}
+
+Tensor<f32, 1> aot_output() {{
+    return {{ output, nullptr, {n} }};
+}}
+
+Status aot_invoke() {{
+    StageScope stage(STAGE_INFERENCE);
+    run(aot_input(), output);
+    return Status{{ nullptr }};
+}}
+
+QTensor<i8, 2> aot_input_q8() {{
+    return {{ Tensor<i8, 2> {{ arena, nullptr, {rows}, {cols} }}, {{ {q.scale()!r}f, {q.zero_point()} }} }};
+}}
+
+Status aot_invoke_q8() {{
+    StageScope stage(STAGE_INFERENCE);
+    run_quantized(output);
+    return Status{{ nullptr }};
+}}
+
+Status aot_inference_into(Tensor<f32, 1> &res, const Tensor<f32, 2> &x) {{
+    StageScope stage(STAGE_INFERENCE);
+    if (x.dim<0>() != {rows} || x.dim<1>() != {cols}) {{
+        THROW(std::runtime_error, "input wrong shape");
+        return take_error();
+    }}
+    if (res.dim<0>() != {n}) {{
+        THROW(std::runtime_error, "output wrong shape");
+        return take_error();
+    }}
+
+    run(x, res.row(0));
+    return Status{{ nullptr }};
+}}
+
+Tensor<f32, 1> aot_inference(const Tensor<f32, 2> &x) {{
+    StageScope stage(STAGE_INFERENCE);
+    auto res = Tensor<f32, 1>::alloc({n});
+    if (!aot_inference_into(res, x).ok()) return {{}};
+    return res;
+}}
+
+{stream}
+// builds that link this in place of tf.cpp and tflm. the model is presented as taking int8 input, so the
+// encoder quantizes its features straight into the buffer and the quantize step never runs.
+#ifdef AOT_INFERENCE
+Tensor<f32, 1> inference(const Tensor<f32, 2> &x) {{
+    return aot_inference(x);
+}}
+Status inference_into(Tensor<f32, 1> &res, const Tensor<f32, 2> &x) {{
+    return aot_inference_into(res, x);
+}}
+u32 inference_output_size() {{
+    return aot_output_size();
+}}
+ArenaScratch inference_scratch() {{
+    return aot_scratch();
+}}
+Tensor<f32, 2> inference_input() {{
+    return {{}};
+}}
+QTensor<i8, 2> inference_input_q8() {{
+    return aot_input_q8();
+}}
+Tensor<f32, 1> inference_output() {{
+    return aot_output();
+}}
+Status inference_invoke() {{
+    return aot_invoke_q8();
+}}
+Status inference_load(const u8 *, u32) {{
+    return Status{{ "compiled models can't be replaced at run time" }};
+}}
+Status inference_load_file(const char *) {{
+    return Status{{ "compiled models can't be replaced at run time" }};
+}}
+Status inference_swap() {{
+    return Status{{ "compiled models can't be replaced at run time" }};
+}}
+u32 inference_generation() {{
+    return 0;
+}}
+void inference_profile(bool) {{}}
+void inference_profile_report(void (*emit)(const char *line)) {{
+    emit("no per-op profile: the model was compiled ahead of time");
+}}
+#endif
+'''
+
+if __name__ == '__main__':
+    source = sys.argv[1] if len(sys.argv) > 1 else 'model.cpp'
+    target = sys.argv[2] if len(sys.argv) > 2 else 'model_aot.cpp'
+    code = generate(source, load_model(source))
+    with open(target, 'w') as f:
+        f.write(code)
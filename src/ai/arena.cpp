@@ -0,0 +1,36 @@
+#include <iostream>
+#include <fstream>
+
+#include "./tf.h"
+#include "./util.h"
+
+// sets the model up in the interpreter, prints how it used the arena and writes the measured minimum to a header
+// that host builds of tf.cpp check TENSOR_ARENA_SIZE against. the numbers are for the build the tool runs in: on a
+// 64-bit host the interpreter's structures are bigger than on the cortex-m4, so they don't size the target's arena.
+int main(int argc, char **argv) {
+    const char *path = argc > 1 ? argv[1] : "arena_size.h";
+
+    inference_arena_report([](const char *line) { std::cout << line << '\n'; });
+    const u32 used = inference_arena_used();
+    if (used == 0) {
+        std::cerr << "model failed to set up; try a bigger TENSOR_ARENA_SIZE\n";
+        return 1;
+    }
+
+    // the encoder borrows the arena's idle part for the frontend when the plan fits next to everything the model took
+    const bool q8 = inference_input_q8().dim<0>() != 0;
+    const u32 plan = FrontendPlan<f32>::for_learning(8000, 8000.0f, !q8).region_size;
+    std::cout << "TENSOR_ARENA_SIZE for the 8 kHz, 1 s frontend to borrow the arena: " << used + plan << '\n';
+
+    std::ofstream f(path);
+    f << "// generated by the arena tool, do not edit\n"
+      << "#ifndef A3EM_AI_ARENA_SIZE_H\n"
+      << "#define A3EM_AI_ARENA_SIZE_H\n\n"
+      << "#define TENSOR_ARENA_MODEL_SIZE " << used << "\n\n"
+      << "#endif\n";
+    if (!f) {
+        std::cerr << "failed to write " << path << '\n';
+        return 1;
+    }
+    std::cout << "wrote " << path << '\n';
+}
@@ -0,0 +1,207 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "./aot.h"
+#include "./model.h"
+#include "./tensor.h"
+#include "./tf.h"
+#include "./util.h"
+
+template<typename T>
+void deleter(T *v) { delete[] v; }
+
+template<typename F>
+f64 time_ns(u32 iters, F f) {
+    f();
+    auto start = std::chrono::steady_clock::now();
+    for (u32 i = 0; i < iters; ++i) f();
+    auto stop = std::chrono::steady_clock::now();
+    return std::chrono::duration<f64, std::nano>(stop - start).count() / iters;
+}
+
+// the original ijk implementation, kept as the baseline
+template<typename T> Tensor<T, 2> matmul_naive(const Tensor<T, 2> &a, const Tensor<T, 2> &b) {
+    if (a.template dim<1>() != b.template dim<0>()) THROW(std::runtime_error, "matmul incompatible sizes");
+
+    Tensor<T, 2> res { new T[a.template dim<0>() * b.template dim<1>()], deleter, a.template dim<0>(), b.template dim<1>() };
+    for (u32 i = 0; i < res.template dim<0>(); ++i) {
+        for (u32 j = 0; j < res.template dim<1>(); ++j) {
+            T acc = (T)0;
+            for (u32 k = 0; k < a.template dim<1>(); ++k) acc += a(i, k) * b(k, j);
+            res(i, j) = acc;
+        }
+    }
+    return res;
+}
+
+void bench_matmul() {
+    const u32 shapes[][3] = { {16, 120, 1}, {16, 16, 65}, {16, 120, 65}, {64, 64, 64}, {128, 512, 128}, {256, 256, 256}, {512, 512, 512} };
+
+    std::cout << "matmul (f32)\n";
+    std::cout << std::setw(18) << "shape" << std::setw(14) << "naive ns" << std::setw(14) << "blocked ns" << std::setw(10) << "speedup" << std::setw(12) << "GFLOP/s" << '\n';
+    for (const auto &shape : shapes) {
+        Tensor<f32, 2> a = Tensor<f32, 2>::alloc(shape[0], shape[1]);
+        Tensor<f32, 2> b = Tensor<f32, 2>::alloc(shape[1], shape[2]);
+        for (u32 i = 0; i < shape[0]; ++i) for (u32 j = 0; j < shape[1]; ++j) a(i, j) = (f32)((i * 7 + j * 3) % 11) / 11;
+        for (u32 i = 0; i < shape[1]; ++i) for (u32 j = 0; j < shape[2]; ++j) b(i, j) = (f32)((i * 5 + j * 13) % 7) / 7;
+
+        const f64 flops = 2.0 * shape[0] * shape[1] * shape[2];
+        const u32 iters = std::max<u32>(1, (u32)(2e8 / flops));
+
+        f32 sink = 0;
+        const f64 naive = time_ns(iters, [&] { sink += matmul_naive(a, b)(0, 0); });
+        const f64 blocked = time_ns(iters, [&] { sink += matmul(a, b)(0, 0); });
+
+        std::cout << std::setw(6) << shape[0] << 'x' << std::setw(4) << shape[1] << 'x' << std::setw(5) << shape[2]
+            << std::setw(14) << std::fixed << std::setprecision(0) << naive << std::setw(14) << blocked
+            << std::setw(9) << std::setprecision(2) << naive / blocked << 'x' << std::setw(12) << flops / blocked
+            << (sink == 12345 ? " " : "") << '\n';
+    }
+}
+
+template<typename T> Tensor<T, 2> transpose_naive(const Tensor<T, 2> &x) {
+    Tensor<T, 2> res { new T[x.size()], deleter, x.template dim<1>(), x.template dim<0>() };
+    for (u32 i = 0; i < x.template dim<0>(); ++i) {
+        for (u32 j = 0; j < x.template dim<1>(); ++j) {
+            res(j, i) = x(i, j);
+        }
+    }
+    return res;
+}
+
+void bench_transpose() {
+    const u32 shapes[][2] = { {65, 120}, {256, 256}, {1024, 1024}, {2000, 300} };
+
+    std::cout << "transpose (f32)\n";
+    std::cout << std::setw(18) << "shape" << std::setw(14) << "naive ns" << std::setw(14) << "tiled ns" << std::setw(10) << "speedup" << '\n';
+    for (const auto &shape : shapes) {
+        Tensor<f32, 2> a = Tensor<f32, 2>::alloc(shape[0], shape[1]);
+        for (u32 i = 0; i < shape[0]; ++i) for (u32 j = 0; j < shape[1]; ++j) a(i, j) = (f32)(i + j);
+
+        const u32 iters = std::max<u32>(1, (u32)(5e7 / a.size()));
+
+        f32 sink = 0;
+        const f64 naive = time_ns(iters, [&] { sink += transpose_naive(a)(0, 0); });
+        const f64 tiled = time_ns(iters, [&] { sink += transpose(a)(0, 0); });
+
+        std::cout << std::setw(11) << shape[0] << 'x' << std::setw(6) << shape[1]
+            << std::setw(14) << std::fixed << std::setprecision(0) << naive << std::setw(14) << tiled
+            << std::setw(9) << std::setprecision(2) << naive / tiled << 'x' << (sink == 12345 ? " " : "") << '\n';
+    }
+}
+
+void bench_inference() {
+    auto clip = Tensor<f32, 1>::alloc(8000);
+    for (u32 i = 0; i < clip.dim<0>(); ++i) clip(i) = std::sin(i * 0.05f) * 0.3f + std::sin(i * 0.71f) * 0.1f;
+    Tensor<f32, 2> features = mfcc_spectrogram_for_learning(clip, 8000.0f);
+    auto embedding = Tensor<f32, 1>::alloc(inference_output_size());
+
+    std::cout << "inference ops\n";
+    if (!inference_into(embedding, features).ok()) return;
+    inference_profile(true);
+    for (u32 i = 0; i < 50; ++i) inference_into(embedding, features);
+    inference_profile(false);
+    inference_profile_report([](const char *line) { std::cout << line << '\n'; });
+}
+
+void bench_inference_batch() {
+    auto clip = Tensor<f32, 1>::alloc(8000);
+    for (u32 i = 0; i < clip.dim<0>(); ++i) clip(i) = std::sin(i * 0.05f) * 0.3f + std::sin(i * 0.71f) * 0.1f;
+    Tensor<f32, 2> features = mfcc_spectrogram_for_learning(clip, 8000.0f);
+    const u32 rows = features.dim<0>(), cols = features.dim<1>();
+
+    std::cout << "inference batches\n";
+    std::cout << std::setw(8) << "batch" << std::setw(14) << "batch us" << std::setw(14) << "us per clip" << std::setw(12) << "clips/s" << '\n';
+    if (inference_output_size() == 0) return;
+    for (u32 batch = 1; batch <= 64; batch *= 2) {
+        Tensor<f32, 3> x = Tensor<f32, 3>::alloc(batch, rows, cols);
+        for (u32 b = 0; b < batch; ++b) for (u32 i = 0; i < rows; ++i) for (u32 j = 0; j < cols; ++j) x(b, i, j) = features(i, j);
+        auto res = Tensor<f32, 2>::alloc(batch, inference_output_size());
+
+        const u32 iters = std::max<u32>(1, 256 / batch);
+        const f64 ns = time_ns(iters, [&] { inference_batch_into(res, x); });
+
+        std::cout << std::setw(8) << batch << std::setw(14) << std::fixed << std::setprecision(0) << ns / 1e3
+            << std::setw(14) << std::setprecision(1) << ns / 1e3 / batch << std::setw(12) << std::setprecision(0) << 1e9 * batch / ns << '\n';
+    }
+}
+
+// a whole window through the compiled model against pushing one hop of new columns into the stream
+void bench_inference_stream() {
+    const u32 hop = aot_stream_hop(), cols = 65 + hop * 64;
+    auto features = Tensor<f32, 2>::alloc(16, cols);
+    for (u32 i = 0; i < 16; ++i) for (u32 j = 0; j < cols; ++j) features(i, j) = std::sin(i * 0.7f + j * 0.13f) * 0.5f;
+    auto res = Tensor<f32, 1>::alloc(aot_output_size());
+
+    std::cout << "streaming inference\n";
+    if (hop == 0) return;
+    u32 start = 0;
+    const f64 window = time_ns(64, [&] {
+        aot_inference_into(res, Tensor<f32, 2>::strided(features.row(0) + start, nullptr, cols, 16, 65));
+        start = (start + hop) % (cols - 65);
+    });
+    aot_stream_reset();
+    aot_stream_push(Tensor<f32, 2>::strided(features.row(0), nullptr, cols, 16, 65));
+    u32 pushed = 65;
+    const f64 step = time_ns(63, [&] {
+        aot_stream_push(Tensor<f32, 2>::strided(features.row(0) + pushed, nullptr, cols, 16, hop));
+        aot_stream_output(res);
+        pushed += hop;
+    });
+    std::cout << std::fixed << std::setprecision(1) << "window " << window / 1e3 << " us, hop " << step / 1e3 << " us ("
+        << std::setprecision(2) << window / step << "x)\n";
+}
+
+#ifndef AOT_INFERENCE
+// one session per thread, each running the same share of the clips
+void bench_inference_threads() {
+    auto clip = Tensor<f32, 1>::alloc(8000);
+    for (u32 i = 0; i < clip.dim<0>(); ++i) clip(i) = std::sin(i * 0.05f) * 0.3f + std::sin(i * 0.71f) * 0.1f;
+    const Tensor<f32, 2> features = mfcc_spectrogram_for_learning(clip, 8000.0f);
+    const u32 clips = 256, cores = std::max<u32>(1, std::thread::hardware_concurrency());
+
+    std::cout << "inference sessions\n";
+    std::cout << std::setw(8) << "threads" << std::setw(14) << "total ms" << std::setw(12) << "clips/s" << std::setw(10) << "speedup" << '\n';
+    f64 single = 0;
+    for (u32 threads = 1; threads <= cores; threads *= 2) {
+        // the pools aren't thread safe, so everything is allocated up front and the workers only run
+        std::vector<std::unique_ptr<InferenceSession>> sessions;
+        std::vector<Tensor<f32, 1>> embeddings;
+        for (u32 t = 0; t < threads; ++t) {
+            sessions.emplace_back(new InferenceSession());
+            if (!sessions.back()->load(model_tflite, model_tflite_len).ok()) return;
+            embeddings.push_back(Tensor<f32, 1>::alloc(sessions.back()->output_size()));
+        }
+
+        std::vector<std::thread> workers;
+        workers.reserve(threads);
+        const auto start = std::chrono::steady_clock::now();
+        for (u32 t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t] {
+                for (u32 i = 0; i < clips / threads; ++i) sessions[t]->run_into(embeddings[t], features);
+            });
+        }
+        for (auto &w : workers) w.join();
+        const f64 ns = std::chrono::duration<f64, std::nano>(std::chrono::steady_clock::now() - start).count();
+        if (threads == 1) single = ns;
+
+        std::cout << std::setw(8) << threads << std::setw(14) << std::fixed << std::setprecision(1) << ns / 1e6
+            << std::setw(12) << std::setprecision(0) << 1e9 * clips / ns << std::setw(9) << std::setprecision(2) << single / ns << "x\n";
+    }
+}
+#endif
+
+int main() {
+    bench_matmul();
+    bench_transpose();
+    bench_inference();
+    bench_inference_batch();
+    bench_inference_stream();
+#ifndef AOT_INFERENCE
+    bench_inference_threads();
+#endif
+}
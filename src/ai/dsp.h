@@ -0,0 +1,169 @@
+#ifndef A3EM_AI_DSP_H
+#define A3EM_AI_DSP_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "./types.h"
+
+#if defined(__ARM_FEATURE_DSP)
+#include <arm_acle.h>
+#endif
+
+// the cortex-m4 simd-within-a-register instructions. on the target they are the acle intrinsics; elsewhere they are
+// bit-exact emulations (wrapping where the hardware wraps, saturating where it saturates) so kernels test on the host.
+// a packed pair holds two i16 in a u32 with the lower-addressed value in the low half.
+
+inline u32 pack16(i16 lo, i16 hi) { return (u32)(u16)lo | (u32)(u16)hi << 16; }
+inline i16 lo16(u32 x) { return (i16)(u16)(x & 0xffff); }
+inline i16 hi16(u32 x) { return (i16)(u16)(x >> 16); }
+inline u32 load16x2(const i16 *p) {
+    u32 v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+inline void store16x2(i16 *p, u32 v) {
+    std::memcpy(p, &v, sizeof(v));
+}
+
+// saturates to a signed bits-wide value
+template<u32 bits> inline i32 ssat(i32 x) {
+    static_assert(bits >= 1 && bits <= 32, "ssat width out of range");
+#if defined(__ARM_FEATURE_DSP)
+    return __ssat(x, bits);
+#else
+    const i64 hi = ((i64)1 << (bits - 1)) - 1, lo = -hi - 1;
+    return (i32)(x > hi ? hi : x < lo ? lo : x);
+#endif
+}
+
+inline i32 qadd(i32 a, i32 b) {
+#if defined(__ARM_FEATURE_DSP)
+    return __qadd(a, b);
+#else
+    const i64 sum = (i64)a + b;
+    return (i32)(sum > INT32_MAX ? INT32_MAX : sum < INT32_MIN ? INT32_MIN : sum);
+#endif
+}
+
+inline u32 qadd16(u32 a, u32 b) {
+#if defined(__ARM_FEATURE_DSP)
+    return (u32)__qadd16((i32)a, (i32)b);
+#else
+    return pack16((i16)ssat<16>(lo16(a) + lo16(b)), (i16)ssat<16>(hi16(a) + hi16(b)));
+#endif
+}
+inline u32 qsub16(u32 a, u32 b) {
+#if defined(__ARM_FEATURE_DSP)
+    return (u32)__qsub16((i32)a, (i32)b);
+#else
+    return pack16((i16)ssat<16>(lo16(a) - lo16(b)), (i16)ssat<16>(hi16(a) - hi16(b)));
+#endif
+}
+
+// bottom x bottom and top x top halves
+inline i32 smulbb(u32 a, u32 b) {
+#if defined(__ARM_FEATURE_DSP)
+    return __smulbb((i32)a, (i32)b);
+#else
+    return (i32)lo16(a) * lo16(b);
+#endif
+}
+inline i32 smultt(u32 a, u32 b) {
+#if defined(__ARM_FEATURE_DSP)
+    return __smultt((i32)a, (i32)b);
+#else
+    return (i32)hi16(a) * hi16(b);
+#endif
+}
+
+// both products summed; the 32 bit additions wrap (the hardware only sets the q flag)
+inline i32 smuad(u32 a, u32 b) {
+#if defined(__ARM_FEATURE_DSP)
+    return __smuad((i32)a, (i32)b);
+#else
+    return (i32)((u32)smulbb(a, b) + (u32)smultt(a, b));
+#endif
+}
+inline i32 smlad(u32 a, u32 b, i32 acc) {
+#if defined(__ARM_FEATURE_DSP)
+    return __smlad((i32)a, (i32)b, acc);
+#else
+    return (i32)((u32)acc + (u32)smulbb(a, b) + (u32)smultt(a, b));
+#endif
+}
+inline i64 smlald(u32 a, u32 b, i64 acc) {
+#if defined(__ARM_FEATURE_DSP)
+    return __smlald((i32)a, (i32)b, acc);
+#else
+    return (i64)((u64)acc + (u64)(i64)smulbb(a, b) + (u64)(i64)smultt(a, b));
+#endif
+}
+
+// q15 conversions, rounding to nearest and saturating
+inline i16 to_q15(f32 x) {
+    return (i16)ssat<16>((i32)std::lround(std::max(-65536.0f, std::min(65536.0f, x * 32768.0f))));
+}
+inline f32 from_q15(i32 x) {
+    return (f32)x / 32768.0f;
+}
+inline void to_q15(i16 *dst, const f32 *src, u32 n) {
+    for (u32 i = 0; i < n; ++i) dst[i] = to_q15(src[i]);
+}
+
+// sum of a[i] * b[i] in q30, exact
+inline i64 dot_q15(const i16 *a, const i16 *b, u32 n) {
+    i64 acc = 0;
+    u32 i = 0;
+    for (; i + 4 <= n; i += 4) {
+        acc = smlald(load16x2(a + i), load16x2(b + i), acc);
+        acc = smlald(load16x2(a + i + 2), load16x2(b + i + 2), acc);
+    }
+    for (; i < n; ++i) acc += (i32)a[i] * b[i];
+    return acc;
+}
+
+// squared euclidean distance in q30, exact. expanded as a.a + b.b - 2 a.b so no difference ever has to saturate.
+inline i64 l2_dist_sqr_q15(const i16 *a, const i16 *b, u32 n) {
+    i64 aa = 0, bb = 0, ab = 0;
+    u32 i = 0;
+    for (; i + 2 <= n; i += 2) {
+        const u32 x = load16x2(a + i), y = load16x2(b + i);
+        aa = smlald(x, x, aa);
+        bb = smlald(y, y, bb);
+        ab = smlald(x, y, ab);
+    }
+    for (; i < n; ++i) {
+        aa += (i32)a[i] * a[i];
+        bb += (i32)b[i] * b[i];
+        ab += (i32)a[i] * b[i];
+    }
+    return aa + bb - 2 * ab;
+}
+
+// dst = src * window in q15 with rounding, two samples per step; dst may be src
+inline void window_q15_into(i16 *dst, const i16 *src, const i16 *window, u32 n) {
+    u32 i = 0;
+    for (; i + 2 <= n; i += 2) {
+        const u32 s = load16x2(src + i), w = load16x2(window + i);
+        const i32 lo = ssat<16>((smulbb(s, w) + 0x4000) >> 15), hi = ssat<16>((smultt(s, w) + 0x4000) >> 15);
+        store16x2(dst + i, pack16((i16)lo, (i16)hi));
+    }
+    for (; i < n; ++i) dst[i] = (i16)ssat<16>(((i32)src[i] * window[i] + 0x4000) >> 15);
+}
+
+// the hann window hann_window_into applies, as a q15 table
+inline void hann_window_q15(i16 *window, u32 n) {
+    for (u32 i = 0; i < n; ++i) {
+        const f32 t = std::cos((f32)3.14159265358979323846 * ((f32)i - (f32)n / 2) / (f32)n);
+        window[i] = to_q15(t * t);
+    }
+}
+
+// res[r] = rows[r] . x in q30 for a row-major rows x n matrix, e.g. the mel filterbank against one power frame
+inline void matvec_q15(i64 *res, const i16 *rows, u32 ld, u32 count, const i16 *x, u32 n) {
+    for (u32 r = 0; r < count; ++r) res[r] = dot_q15(rows + r * ld, x, n);
+}
+
+#endif
@@ -0,0 +1,108 @@
+#ifndef A3EM_AI_ENCODER_H
+#define A3EM_AI_ENCODER_H
+
+#include "./util.h"
+#include "./pool.h"
+#include "./tf.h"
+
+// the whole encode path (filter, spectrogram, mfcc, normalization, inference) with its storage set up by init(),
+// so encode() never allocates. the frontend runs in the idle part of the tensor arena when the plan fits there;
+// otherwise a buffer is taken from the shared sram pool once, which ZERO_HEAP builds only allow before the pool is
+// sealed (encode_init() inits first and seals after).
+// the features are written straight into the model's input tensor (quantized on the way when the model takes
+// int8 input) and the embedding is read from its output.
+class Encoder {
+private:
+
+    FrontendPlan<f32> plan;
+    u8 *region;
+    u8 *owned;
+    u32 owned_size;
+    u32 generation;  // of the model the plan was checked against and the scratch borrowed from
+    bool ready;
+
+public:
+
+    Encoder() : plan{}, region{nullptr}, owned{nullptr}, owned_size{0}, generation{0}, ready{false} {}
+    ~Encoder() { aligned_delete(owned); }
+
+    Encoder(const Encoder &other) = delete;
+    Encoder &operator=(const Encoder &other) = delete;
+
+    Status init(u32 signal_len, f32 sample_rate) {
+        const QTensor<i8, 2> quantized = inference_input_q8();
+        const Tensor<f32, 2> features = inference_input();
+        const bool q8 = quantized.dim<0>() != 0;
+        plan = FrontendPlan<f32>::for_learning(signal_len, sample_rate, !q8);
+        const u32 rows = q8 ? quantized.dim<0>() : features.dim<0>(), cols = q8 ? quantized.dim<1>() : features.dim<1>();
+        if (rows != plan.dct_filters || cols != plan.chunks) {
+            ready = false;
+            return Status{ "model input does not match the frontend" };
+        }
+        const ArenaScratch scratch = inference_scratch();
+        generation = inference_generation();
+
+        region = nullptr;
+        if (plan.region_size <= scratch.size) {
+            region = scratch.data;
+        } else {
+            if (plan.region_size > owned_size) {
+                RegionScope scope(REGION_SHARED);
+                aligned_delete(owned);
+                owned = aligned_new<u8>(plan.region_size);
+                owned_size = owned ? plan.region_size : 0;
+            }
+            region = owned;
+        }
+        ready = region != nullptr;
+        return ready ? Status{ nullptr } : Status{ "no room for the frontend buffers" };
+    }
+
+    // whether the frontend runs in the tensor arena rather than a buffer of its own
+    bool borrows_arena() const { return ready && region != owned; }
+
+    bool ready_for(u32 signal_len, f32 sample_rate) const {
+        return ready && plan.signal_len == signal_len && plan.sample_rate == sample_rate && generation == inference_generation();
+    }
+
+    // input is filtered and normalized in place. outside of ZERO_HEAP builds a clip of a new shape re-initializes.
+    // after a model swap it re-initializes in every build; that only re-checks the plan and re-borrows the scratch.
+    // in NO_EXCEPTIONS builds a failure anywhere in the frontend stops the encode before inference runs on it.
+    // embedding becomes a view of the model output, valid until the next encode.
+    Status encode(f32 *input, u32 input_len, f32 sample_rate, Tensor<f32, 1> &embedding) {
+        if (!ready_for(input_len, sample_rate)) {
+#ifdef ZERO_HEAP
+            if (!ready || plan.signal_len != input_len || plan.sample_rate != sample_rate) return Status{ "encoder not initialized for this clip shape" };
+#endif
+            const Status status = init(input_len, sample_rate);
+            if (!status.ok()) return status;
+        }
+
+        take_error();
+        Tensor<f32, 1> signal { input, nullptr, input_len };
+        QTensor<i8, 2> quantized = inference_input_q8();
+        if (quantized.dim<0>() != 0) {
+            mfcc_spectrogram_for_learning_into(quantized, signal, plan, region);
+        } else {
+            Tensor<f32, 2> features = inference_input();
+            mfcc_spectrogram_for_learning_into(features, signal, plan, region);
+        }
+        if (!pending_error().ok()) return take_error();
+        const Status status = inference_invoke();
+        if (!status.ok()) return status;
+        embedding = inference_output();
+        return Status{ nullptr };
+    }
+
+    // same, copying the embedding out for callers that own the output buffer
+    Status encode(f32 *input, u32 input_len, f32 sample_rate, f32 *output, u32 output_len) {
+        Tensor<f32, 1> embedding;
+        const Status status = encode(input, input_len, sample_rate, embedding);
+        if (!status.ok()) return status;
+        if (embedding.dim<0>() != output_len) return Status{ "output wrong shape" };
+        for (u32 i = 0; i < output_len; ++i) output[i] = embedding(i);
+        return Status{ nullptr };
+    }
+};
+
+#endif
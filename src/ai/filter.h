@@ -3,29 +3,48 @@
 
 #include <cstring>
 #include <algorithm>
+#include <type_traits>
 
+#include "./dsp.h"
+
+// squared distance between two embeddings; q15 embeddings go through the dsp kernel and come back in q30
+template<typename T> T filter_l2_norm_sqr(const T *a, const T *b, int E) noexcept {
+    // two accumulators so the adds overlap
+    T res0 = 0, res1 = 0;
+    int i = 0;
+    for (; i + 2 <= E; i += 2) {
+        T c0 = a[i] - b[i], c1 = a[i + 1] - b[i + 1];
+        res0 += c0 * c0;
+        res1 += c1 * c1;
+    }
+    if (i < E) res0 += (a[i] - b[i]) * (a[i] - b[i]);
+    return res0 + res1;
+}
+inline i64 filter_l2_norm_sqr(const i16 *a, const i16 *b, int E) noexcept {
+    return l2_dist_sqr_q15(a, b, (u32)E);
+}
+
+// T is a floating point type, or i16 for q15 embeddings (radius in q15, weights as plain counts)
 template<typename T, int N, int E>
 class Filter {
 private:
+    // distances and weighted sums need more room than a q15 value
+    typedef std::conditional_t<std::is_integral<T>::value, i64, T> acc_t;
+
     T means[N][E];
     T weights[N];
-    const T base_radius_sqr;
+    const acc_t base_radius_sqr;
     const T max_weight;
 
-    static T l2_norm_sqr(const T a[E], const T b[E]) noexcept {
-        T res = 0;
-        for (int i = 0; i < E; ++i) {
-            T c = a[i] - b[i];
-            res += c * c;
-        }
-        return res;
+    static acc_t l2_norm_sqr(const T a[E], const T b[E]) noexcept {
+        return filter_l2_norm_sqr(a, b, E);
     }
 
 public:
     const T (&inspect_means() const noexcept)[N][E] { return means; }
     const T (&inspect_weights() const noexcept)[N] { return weights; }
 
-    Filter(T _base_radius, T _max_weight) noexcept : base_radius_sqr(_base_radius * _base_radius), max_weight(_max_weight) {
+    Filter(T _base_radius, T _max_weight) noexcept : base_radius_sqr((acc_t)_base_radius * _base_radius), max_weight(_max_weight) {
         reset();
     }
 
@@ -35,14 +54,14 @@ public:
     }
 
     bool insert(const T mean[E]) & noexcept {
-        T center[E];
-        T center_weight = 1;
-        memcpy(center, mean, sizeof(center));
+        acc_t center[E];
+        acc_t center_weight = 1;
+        for (int j = 0; j < E; ++j) center[j] = mean[j];
 
         int p = N;
         for (int i = N; i-- > 0; ) {
-            if (Filter::l2_norm_sqr(means[i], mean) <= weights[i] * base_radius_sqr) {
-                for (int j = 0; j < E; ++j) center[j] += means[i][j] * weights[i];
+            if (Filter::l2_norm_sqr(means[i], mean) <= (acc_t)weights[i] * base_radius_sqr) {
+                for (int j = 0; j < E; ++j) center[j] += (acc_t)means[i][j] * weights[i];
                 center_weight += weights[i];
             } else {
                 --p;
@@ -59,8 +78,8 @@ public:
         --p;
         memset(&means[0], 0, p * sizeof(*means));
         memset(&weights[0], 0, p * sizeof(*weights));
-        for (int i = 0; i < E; ++i) means[N - 1][i] = center[i] / center_weight;
-        weights[N - 1] = std::min(center_weight, max_weight);
+        for (int i = 0; i < E; ++i) means[N - 1][i] = (T)(center[i] / center_weight);
+        weights[N - 1] = (T)std::min(center_weight, (acc_t)max_weight);
 
         return center_weight == 1;
     }
@@ -0,0 +1,433 @@
+#ifndef A3EM_AI_FUSE_H
+#define A3EM_AI_FUSE_H
+
+#include <cstring>
+
+#include "./types.h"
+
+// rewrites a tflite flatbuffer so each conv2d runs together with the leaky relu after it as one custom op, which
+// tf.cpp registers with the interpreter. the converted model wraps every leaky relu in a transpose pair (onnx layout),
+// so conv -> transpose -> leaky relu -> inverse transpose fuses whole, and conv -> transpose -> leaky relu becomes the
+// fused op followed by the transpose. like aot.py, this reads the flatbuffer directly, so it needs nothing from tflm.
+
+#define CONV_LEAKY_OP "A3EM_CONV_LEAKY"
+
+// a fused op's custom options: the conv's options and its own output quantization (the leaky relu's input), then
+// the leaky relu's alpha and output quantization, which the kernel uses in place of the output tensor's
+struct ConvLeakyOptions {
+    i32 padding, activation;
+    i32 stride_w, stride_h, dilation_w, dilation_h;
+    f32 conv_scale;
+    i32 conv_zero_point;
+    f32 alpha;
+    f32 out_scale;
+    i32 out_zero_point;
+};
+
+// a table in a flatbuffer the verifier has already accepted
+struct FlatTable {
+    const u8 *p;
+
+    template<typename T> static T load(const u8 *at) {
+        T v;
+        std::memcpy(&v, at, sizeof(T));
+        return v;
+    }
+    const u8 *at(u32 i) const {
+        const u8 *vtable = p - load<i32>(p);
+        const u32 o = 4 + 2 * i;
+        const u16 field = o < load<u16>(vtable) ? load<u16>(vtable + o) : 0;
+        return field ? p + field : nullptr;
+    }
+    template<typename T> T scalar(u32 i, T def = 0) const {
+        const u8 *a = at(i);
+        return a ? load<T>(a) : def;
+    }
+    // the table, vector or string an offset field points at, or null if the field is absent
+    const u8 *ref(u32 i) const {
+        const u8 *a = at(i);
+        return a ? a + load<u32>(a) : nullptr;
+    }
+    FlatTable table(u32 i) const { return { ref(i) }; }
+    u32 count(u32 i) const { return ref(i) ? load<u32>(ref(i)) : 0; }
+    template<typename T> T element(u32 i, u32 k) const { return load<T>(ref(i) + 4 + sizeof(T) * k); }
+    FlatTable item(u32 i, u32 k) const {
+        const u8 *e = ref(i) + 4 + 4 * k;
+        return { e + load<u32>(e) };
+    }
+};
+
+// writes flatbuffer objects front to back, so an offset always points at something written after it, as the format
+// wants. without a buffer it only counts bytes, which sizes the rewrite before anything moves.
+struct FlatWriter {
+    u8 *buf;
+    u32 pos;
+
+    u32 skip(u32 n) {
+        if (buf) std::memset(buf + pos, 0, n);
+        pos += n;
+        return pos - n;
+    }
+    void align(u32 a) { skip((a - pos % a) % a); }
+    void put(u32 at, const void *v, u32 n) {
+        if (buf) std::memcpy(buf + at, v, n);
+    }
+    void put32(u32 at, u32 v) { put(at, &v, 4); }
+    void ref(u32 at, u32 target) { put32(at, target - at); }
+    // an object of the model being rewritten, which sits past everything written here
+    void ref(u32 at, const u8 *target) {
+        if (buf) ref(at, (u32)(target - buf));
+    }
+
+    struct Table {
+        u32 pos, mask;
+        // where field i goes: fields get 4 byte slots in field order
+        u32 slot(u32 i) const {
+            u32 rank = 0;
+            for (u32 k = 0; k < i; ++k) rank += mask >> k & 1;
+            return pos + 4 + 4 * rank;
+        }
+    };
+    Table table(u32 mask) {
+        u32 n = 0, fields = 0;
+        for (u32 i = 0; i < 32; ++i) {
+            if (!(mask >> i & 1)) continue;
+            n = i + 1;
+            ++fields;
+        }
+        align(4);
+        const u32 vtable = skip(4 + 2 * n);
+        align(4);
+        const Table res = { skip(4 + 4 * fields), mask };
+        const u16 sizes[2] = { (u16)(4 + 2 * n), (u16)(4 + 4 * fields) };
+        put(vtable, sizes, 4);
+        for (u32 i = 0; i < n; ++i) {
+            const u16 o = mask >> i & 1 ? (u16)(res.slot(i) - res.pos) : 0;
+            put(vtable + 4 + 2 * i, &o, 2);
+        }
+        put32(res.pos, res.pos - vtable);
+        return res;
+    }
+    u32 vector(u32 n, u32 size) {
+        align(4);
+        const u32 res = skip(4 + n * size);
+        put32(res, n);
+        return res;
+    }
+
+    // a copy of t's first n fields: the 4 byte scalars in scalars by value, the rest as offsets to the same objects.
+    // fields in extra are given slots even if t doesn't have them, to be filled in after.
+    Table copy(FlatTable t, u32 n, u32 scalars, u32 extra) {
+        u32 mask = extra;
+        for (u32 i = 0; i < n; ++i) if (t.at(i)) mask |= 1u << i;
+        const Table res = table(mask);
+        for (u32 i = 0; i < n; ++i) {
+            if (!t.at(i)) continue;
+            if (scalars >> i & 1) put32(res.slot(i), t.scalar<u32>(i));
+            else ref(res.slot(i), t.ref(i));
+        }
+        return res;
+    }
+};
+
+namespace conv_leaky {
+
+// builtin operators, tensor types and the fields read here, as numbered in the tflite schema
+constexpr i32 CONV_2D = 3, CUSTOM = 32, TRANSPOSE = 39, LEAKY_RELU = 98;
+constexpr i8 INT8 = 9;
+constexpr u8 CONV_2D_OPTIONS = 1;
+enum { MODEL_VERSION, MODEL_OPERATOR_CODES, MODEL_SUBGRAPHS, MODEL_BUFFERS = 4, MODEL_SIGNATURE_DEFS = 7 };
+enum { GRAPH_TENSORS, GRAPH_INPUTS, GRAPH_OUTPUTS, GRAPH_OPERATORS, GRAPH_DEBUG_METADATA = 5 };
+enum { OP_OPCODE, OP_INPUTS, OP_OUTPUTS, OP_OPTIONS_TYPE, OP_OPTIONS, OP_CUSTOM_OPTIONS, OP_CUSTOM_OPTIONS_FORMAT };
+enum { SIGNATURE_INPUTS, SIGNATURE_OUTPUTS, SIGNATURE_SUBGRAPH_INDEX = 4 };
+enum { TENSOR_MAP_NAME, TENSOR_MAP_INDEX };
+enum { CODE_DEPRECATED_BUILTIN, CODE_CUSTOM, CODE_VERSION, CODE_BUILTIN };
+enum { TENSOR_TYPE = 1, TENSOR_BUFFER, TENSOR_QUANTIZATION = 4 };
+
+struct Graph {
+    FlatTable model, graph;
+    u32 ops;
+
+    FlatTable op(u32 i) const { return graph.item(GRAPH_OPERATORS, i); }
+    i32 code(FlatTable op) const {
+        const FlatTable c = model.item(MODEL_OPERATOR_CODES, op.scalar<u32>(OP_OPCODE));
+        const i32 deprecated = c.scalar<i8>(CODE_DEPRECATED_BUILTIN), builtin = c.scalar<i32>(CODE_BUILTIN);
+        return deprecated > builtin ? deprecated : builtin;
+    }
+    FlatTable tensor(i32 t) const { return graph.item(GRAPH_TENSORS, (u32)t); }
+    bool int8(i32 t) const { return t >= 0 && tensor(t).scalar<i8>(TENSOR_TYPE) == INT8; }
+    bool per_tensor(i32 t, f32 &scale, i32 &zero_point) const {
+        const FlatTable q = tensor(t).table(TENSOR_QUANTIZATION);
+        if (!q.p || q.count(2) != 1 || q.count(3) != 1) return false;
+        scale = q.element<f32>(2, 0);
+        zero_point = (i32)q.element<i64>(3, 0);
+        return true;
+    }
+    // only read by op `by` (and not a graph output), so nothing else notices when it disappears
+    bool private_to(i32 t, u32 by) const {
+        for (u32 i = 0; i < graph.count(GRAPH_OUTPUTS); ++i) if (graph.element<i32>(GRAPH_OUTPUTS, i) == t) return false;
+        for (u32 i = 0; i < ops; ++i) {
+            const FlatTable o = op(i);
+            for (u32 k = 0; k < o.count(OP_INPUTS); ++k) if (o.element<i32>(OP_INPUTS, k) == t && i != by) return false;
+        }
+        return true;
+    }
+    i32 input(FlatTable op, u32 k = 0) const { return op.count(OP_INPUTS) > k ? op.element<i32>(OP_INPUTS, k) : -1; }
+    i32 output(FlatTable op) const { return op.count(OP_OUTPUTS) == 1 ? op.element<i32>(OP_OUTPUTS, 0) : -1; }
+    // the constant permutation a transpose applies
+    u32 perm(FlatTable op, i32 (&res)[8]) const {
+        const i32 t = input(op, 1);
+        if (t < 0) return 0;
+        const FlatTable b = model.item(MODEL_BUFFERS, tensor(t).scalar<u32>(TENSOR_BUFFER));
+        const u32 n = b.count(0) / 4;
+        if (n > 8) return 0;
+        for (u32 i = 0; i < n; ++i) res[i] = FlatTable::load<i32>(b.ref(0) + 4 + 4 * i);
+        return n;
+    }
+};
+
+// what the ops starting at i fuse into. span is 0 if op i doesn't start a fusable group.
+struct Match {
+    u32 span;
+    FlatTable conv, leaky, last, moved;  // moved is the transpose that ends up after the fused op, if any
+    ConvLeakyOptions options;
+};
+
+inline Match match(const Graph &g, u32 i) {
+    Match m = {};
+    if (i + 1 >= g.ops) return m;
+    const FlatTable conv = g.op(i), next = g.op(i + 1);
+    const i32 t = g.output(conv);
+    if (g.code(conv) != CONV_2D || conv.scalar<u8>(OP_OPTIONS_TYPE) != CONV_2D_OPTIONS || !g.int8(g.input(conv)) || !g.int8(t)) return m;
+    if (g.input(next) != t || !g.private_to(t, i + 1)) return m;
+
+    m.conv = conv;
+    if (g.code(next) == LEAKY_RELU) {
+        m.span = 2;
+        m.leaky = m.last = next;
+    } else if (g.code(next) == TRANSPOSE && i + 2 < g.ops && g.code(g.op(i + 2)) == LEAKY_RELU) {
+        const FlatTable leaky = g.op(i + 2);
+        if (g.input(leaky) != g.output(next) || !g.private_to(g.output(next), i + 2)) return m;
+        m.leaky = leaky;
+        i32 p[8], q[8];
+        const FlatTable after = i + 3 < g.ops ? g.op(i + 3) : FlatTable{ nullptr };
+        const u32 n = g.perm(next, p);
+        bool inverse = n > 0 && after.p && g.code(after) == TRANSPOSE && g.input(after) == g.output(leaky) && g.private_to(g.output(leaky), i + 3)
+            && g.perm(after, q) == n;
+        for (u32 k = 0; inverse && k < n; ++k) inverse = q[k] >= 0 && (u32)q[k] < n && p[q[k]] == (i32)k;
+        if (inverse) {
+            m.span = 4;
+            m.last = after;
+        } else {
+            m.span = 3;
+            m.last = conv;
+            m.moved = next;
+        }
+    } else {
+        return m;
+    }
+
+    ConvLeakyOptions &o = m.options;
+    const FlatTable c = conv.table(OP_OPTIONS);
+    o.padding = c.scalar<i8>(0);
+    o.stride_w = c.scalar<i32>(1);
+    o.stride_h = c.scalar<i32>(2);
+    o.activation = c.scalar<i8>(3);
+    o.dilation_w = c.scalar<i32>(4, 1);
+    o.dilation_h = c.scalar<i32>(5, 1);
+    const FlatTable l = m.leaky.table(OP_OPTIONS);
+    o.alpha = l.p ? l.scalar<f32>(0) : 0.0f;
+    const i32 out = g.output(m.leaky);
+    if (o.activation > 3 || !g.int8(out) || !g.per_tensor(t, o.conv_scale, o.conv_zero_point) || !g.per_tensor(out, o.out_scale, o.out_zero_point)) m.span = 0;
+    return m;
+}
+
+// the tensors the rewritten ops and the graph's inputs and outputs still use. the ones in between the ops of a fused
+// group are left out, since tflm's planner rejects a tensor that nothing writes or reads, and the rest are renumbered
+// in their old order. a fixed bitmap, so bigger graphs don't fuse.
+struct Kept {
+    static constexpr u32 MAX_TENSORS = 1024;
+    u32 bits[MAX_TENSORS / 32];
+    u32 tensors;
+
+    // false if an index is out of range
+    bool mark(FlatTable t, u32 field) {
+        for (u32 k = 0; k < t.count(field); ++k) {
+            const i32 i = t.element<i32>(field, k);
+            if (i >= (i32)tensors) return false;
+            if (i >= 0) bits[i / 32] |= 1u << i % 32;
+        }
+        return true;
+    }
+    bool has(u32 i) const { return bits[i / 32] >> i % 32 & 1; }
+    i32 index(i32 i) const {
+        if (i < 0) return i;
+        u32 res = __builtin_popcount(bits[i / 32] & ((1u << i % 32) - 1));
+        for (u32 k = 0; k < (u32)i / 32; ++k) res += __builtin_popcount(bits[k]);
+        return (i32)res;
+    }
+    u32 count() const {
+        u32 res = 0;
+        for (u32 k = 0; k < MAX_TENSORS / 32; ++k) res += __builtin_popcount(bits[k]);
+        return res;
+    }
+    // a copy of t's vector of tensor indices, renumbered
+    u32 write(FlatWriter &w, FlatTable t, u32 field) const {
+        const u32 n = t.count(field), res = w.vector(n, 4);
+        for (u32 k = 0; k < n; ++k) w.put32(res + 4 + 4 * k, (u32)index(t.element<i32>(field, k)));
+        return res;
+    }
+};
+
+// a copy of op that reads in's inputs and writes out's outputs
+inline void write_op(FlatWriter &w, const Kept &kept, FlatTable op, FlatTable in, FlatTable out, u32 slot) {
+    u32 mask = 1u << OP_OPCODE | 1u << OP_INPUTS | 1u << OP_OUTPUTS;
+    for (u32 i = OP_OPTIONS_TYPE; i <= OP_CUSTOM_OPTIONS_FORMAT; ++i) if (op.at(i)) mask |= 1u << i;
+    const FlatWriter::Table t = w.table(mask);
+    w.ref(slot, t.pos);
+    w.put32(t.slot(OP_OPCODE), op.scalar<u32>(OP_OPCODE));
+    if (mask >> OP_OPTIONS_TYPE & 1) w.put32(t.slot(OP_OPTIONS_TYPE), op.scalar<u8>(OP_OPTIONS_TYPE));
+    if (mask >> OP_OPTIONS & 1) w.ref(t.slot(OP_OPTIONS), op.ref(OP_OPTIONS));
+    if (mask >> OP_CUSTOM_OPTIONS & 1) w.ref(t.slot(OP_CUSTOM_OPTIONS), op.ref(OP_CUSTOM_OPTIONS));
+    if (mask >> OP_CUSTOM_OPTIONS_FORMAT & 1) w.put32(t.slot(OP_CUSTOM_OPTIONS_FORMAT), op.scalar<u8>(OP_CUSTOM_OPTIONS_FORMAT));
+    w.ref(t.slot(OP_INPUTS), kept.write(w, in, OP_INPUTS));
+    w.ref(t.slot(OP_OUTPUTS), kept.write(w, out, OP_OUTPUTS));
+}
+
+// a fused op in place of the match, then the transpose it moved, if any. returns how many ops that is.
+inline u32 write_ops(FlatWriter &w, const Kept &kept, const Match &m, u32 slot, u32 opcode) {
+    const FlatWriter::Table op = w.table(1u << OP_OPCODE | 1u << OP_INPUTS | 1u << OP_OUTPUTS | 1u << OP_CUSTOM_OPTIONS);
+    w.ref(slot, op.pos);
+    w.put32(op.slot(OP_OPCODE), opcode);
+    w.ref(op.slot(OP_INPUTS), kept.write(w, m.conv, OP_INPUTS));
+    w.ref(op.slot(OP_OUTPUTS), kept.write(w, m.last, OP_OUTPUTS));
+    const u32 options = w.vector(sizeof(ConvLeakyOptions), 1);
+    w.put(options + 4, &m.options, sizeof(ConvLeakyOptions));
+    w.ref(op.slot(OP_CUSTOM_OPTIONS), options);
+    if (!m.moved.p) return 1;
+    write_op(w, kept, m.moved, m.moved, m.leaky, slot + 4);
+    return 2;
+}
+
+// the model's signature defs with their tensor indices renumbered
+inline void write_signatures(FlatWriter &w, const Kept &kept, FlatTable root, u32 slot) {
+    const u32 n = root.count(MODEL_SIGNATURE_DEFS), list = w.vector(n, 4);
+    w.ref(slot, list);
+    for (u32 i = 0; i < n; ++i) {
+        const FlatTable def = root.item(MODEL_SIGNATURE_DEFS, i);
+        const FlatWriter::Table t = w.copy(def, 5, 1u << SIGNATURE_SUBGRAPH_INDEX, 0);
+        w.ref(list + 4 + 4 * i, t.pos);
+        for (u32 f = SIGNATURE_INPUTS; f <= SIGNATURE_OUTPUTS; ++f) {
+            if (!def.at(f)) continue;
+            const u32 maps = w.vector(def.count(f), 4);
+            w.ref(t.slot(f), maps);
+            for (u32 k = 0; k < def.count(f); ++k) {
+                const FlatTable map = def.item(f, k);
+                const FlatWriter::Table m = w.copy(map, 2, 1u << TENSOR_MAP_INDEX, 1u << TENSOR_MAP_INDEX);
+                w.ref(maps + 4 + 4 * k, m.pos);
+                w.put32(m.slot(TENSOR_MAP_INDEX), (u32)kept.index((i32)map.scalar<u32>(TENSOR_MAP_INDEX)));
+            }
+        }
+    }
+}
+
+// the front of the rewritten model: a new root table, operator codes with the fused op added, a subgraph with the new
+// operator list and the tensors it still uses, and signature defs renumbered to match, all pointing into the original
+// model (which follows) for everything else. returns how many groups fused; w.pos is the size of the front.
+inline u32 write_front(FlatWriter &w, const u8 *model) {
+    const FlatTable root = { model + FlatTable::load<u32>(model) };
+    if (root.count(MODEL_SUBGRAPHS) != 1) return 0;
+    const Graph g = { root, root.item(MODEL_SUBGRAPHS, 0), root.item(MODEL_SUBGRAPHS, 0).count(GRAPH_OPERATORS) };
+    // buffers stored past the flatbuffer are found by absolute offset, which moving the model would break
+    for (u32 i = 0; i < root.count(MODEL_BUFFERS); ++i) if (root.item(MODEL_BUFFERS, i).scalar<u64>(1)) return 0;
+
+    Kept kept = {};
+    kept.tensors = g.graph.count(GRAPH_TENSORS);
+    if (kept.tensors > Kept::MAX_TENSORS) return 0;
+    bool valid = kept.mark(g.graph, GRAPH_INPUTS) && kept.mark(g.graph, GRAPH_OUTPUTS);
+    u32 groups = 0, ops = 0;
+    for (u32 i = 0; i < g.ops && valid; ++i) {
+        const FlatTable op = g.op(i);
+        // fields past these (intermediates, variable inputs, large options) would need renumbering or moving too
+        for (u32 f = OP_CUSTOM_OPTIONS_FORMAT + 1; f < 16; ++f) valid = valid && !op.at(f);
+        const Match m = match(g, i);
+        if (!m.span) {
+            valid = valid && kept.mark(op, OP_INPUTS) && kept.mark(op, OP_OUTPUTS);
+            ++ops;
+            continue;
+        }
+        valid = valid && kept.mark(m.conv, OP_INPUTS) && kept.mark(m.last, OP_OUTPUTS);
+        if (m.moved.p) valid = valid && kept.mark(m.moved, OP_INPUTS) && kept.mark(m.leaky, OP_OUTPUTS);
+        ++groups;
+        ops += m.moved.p ? 2 : 1;
+        i += m.span - 1;
+    }
+    if (!groups || !valid) return 0;
+
+    w.skip(8);
+    w.put(4, model + 4, 4);
+    const FlatWriter::Table model_table = w.copy(root, 8, 1u << MODEL_VERSION, 1u << MODEL_OPERATOR_CODES | 1u << MODEL_SUBGRAPHS);
+    w.ref(0, model_table.pos);
+
+    const u32 codes = root.count(MODEL_OPERATOR_CODES), code_list = w.vector(codes + 1, 4);
+    w.ref(model_table.slot(MODEL_OPERATOR_CODES), code_list);
+    for (u32 i = 0; i < codes; ++i) w.ref(code_list + 4 + 4 * i, root.item(MODEL_OPERATOR_CODES, i).p);
+    const FlatWriter::Table code = w.table(0xf);
+    w.ref(code_list + 4 + 4 * codes, code.pos);
+    w.put32(code.slot(CODE_DEPRECATED_BUILTIN), CUSTOM);
+    w.put32(code.slot(CODE_VERSION), 1);
+    w.put32(code.slot(CODE_BUILTIN), CUSTOM);
+    // a string is a byte vector followed by a terminator it doesn't count
+    const u32 name = w.vector(sizeof(CONV_LEAKY_OP) - 1, 1);
+    w.skip(1);
+    w.put(name + 4, CONV_LEAKY_OP, sizeof(CONV_LEAKY_OP) - 1);
+    w.ref(code.slot(CODE_CUSTOM), name);
+
+    const u32 graphs = w.vector(1, 4);
+    w.ref(model_table.slot(MODEL_SUBGRAPHS), graphs);
+    const FlatWriter::Table graph = w.copy(g.graph, 6, 1u << GRAPH_DEBUG_METADATA, 1u << GRAPH_TENSORS | 1u << GRAPH_INPUTS | 1u << GRAPH_OUTPUTS | 1u << GRAPH_OPERATORS);
+    w.ref(graphs + 4, graph.pos);
+    const u32 tensors = w.vector(kept.count(), 4);
+    w.ref(graph.slot(GRAPH_TENSORS), tensors);
+    for (u32 i = 0, k = 0; i < kept.tensors; ++i) if (kept.has(i)) w.ref(tensors + 4 + 4 * k++, g.tensor((i32)i).p);
+    w.ref(graph.slot(GRAPH_INPUTS), kept.write(w, g.graph, GRAPH_INPUTS));
+    w.ref(graph.slot(GRAPH_OUTPUTS), kept.write(w, g.graph, GRAPH_OUTPUTS));
+    const u32 op_list = w.vector(ops, 4);
+    w.ref(graph.slot(GRAPH_OPERATORS), op_list);
+    for (u32 i = 0, k = 0; i < g.ops; ++i) {
+        const Match m = match(g, i);
+        const u32 slot = op_list + 4 + 4 * k;
+        if (!m.span) {
+            write_op(w, kept, g.op(i), g.op(i), g.op(i), slot);
+            ++k;
+            continue;
+        }
+        k += write_ops(w, kept, m, slot, codes);
+        i += m.span - 1;
+    }
+    if (root.at(MODEL_SIGNATURE_DEFS)) write_signatures(w, kept, root, model_table.slot(MODEL_SIGNATURE_DEFS));
+    // buffer data is 16 byte aligned in the flatbuffer and stays that way
+    w.align(16);
+    return groups;
+}
+
+}
+
+// the size model takes once fused, or len if nothing in it fuses. model must have passed the flatbuffer verifier.
+inline u32 conv_leaky_fused_size(const u8 *model, u32 len) {
+    FlatWriter w = { nullptr, 0 };
+    return conv_leaky::write_front(w, model) ? len + w.pos : len;
+}
+
+// fuses the model in the first len bytes of buf (16 byte aligned, buf_size bytes) in place and returns its new length.
+// models with nothing to fuse, or that wouldn't fit, are left as they are and len comes back.
+inline u32 fuse_conv_leaky(u8 *buf, u32 len, u32 buf_size) {
+    const u32 size = conv_leaky_fused_size(buf, len);
+    if (size == len || size > buf_size) return len;
+    std::memmove(buf + (size - len), buf, len);
+    FlatWriter w = { buf, 0 };
+    conv_leaky::write_front(w, buf + (size - len));
+    return size;
+}
+
+#endif
@@ -0,0 +1,158 @@
+#ifndef A3EM_AI_HALF_H
+#define A3EM_AI_HALF_H
+
+#include <cstring>
+
+#include "./tensor.h"
+
+// x86 hosts convert f16 in batches with f16c when the cpu has it; the build flags don't need to enable it
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HALF_F16C
+#include <immintrin.h>
+#endif
+
+// storage-only half precision types, arithmetic is always done after widening to f32
+struct f16 { u16 bits; };
+struct bf16 { u16 bits; };
+
+inline f16 to_f16(f32 v) {
+#if defined(__ARM_FP16_FORMAT_IEEE)
+    __fp16 h = (__fp16)v;
+    f16 res;
+    std::memcpy(&res.bits, &h, sizeof(res.bits));
+    return res;
+#else
+    u32 x;
+    std::memcpy(&x, &v, sizeof(x));
+    const u32 sign = (x >> 16) & 0x8000;
+    const u32 exp = (x >> 23) & 0xff;
+    u32 mant = x & 0x7fffff;
+
+    if (exp == 0xff) return { (u16)(sign | 0x7c00 | (mant ? 0x200 | (mant >> 13) : 0)) };
+
+    const i32 e = (i32)exp - 127 + 15;
+    if (e >= 31) return { (u16)(sign | 0x7c00) };
+    if (e <= 0) {
+        if (e < -10) return { (u16)sign };
+        mant |= 0x800000;
+        const u32 shift = 14 - e;
+        u32 h = mant >> shift;
+        const u32 rem = mant & ((1u << shift) - 1), half = 1u << (shift - 1);
+        if (rem > half || (rem == half && (h & 1))) ++h;
+        return { (u16)(sign | h) };
+    }
+
+    u32 h = ((u32)e << 10) | (mant >> 13);
+    const u32 rem = mant & 0x1fff;
+    if (rem > 0x1000 || (rem == 0x1000 && (h & 1))) ++h; // a carry out of the mantissa correctly rounds up to the next exponent or inf
+    return { (u16)(sign | h) };
+#endif
+}
+
+inline f32 to_f32(f16 h) {
+#if defined(__ARM_FP16_FORMAT_IEEE)
+    __fp16 v;
+    std::memcpy(&v, &h.bits, sizeof(h.bits));
+    return (f32)v;
+#else
+    const u32 sign = (u32)(h.bits & 0x8000) << 16;
+    const u32 exp = (h.bits >> 10) & 0x1f;
+    u32 mant = h.bits & 0x3ff;
+
+    u32 x;
+    if (exp == 0x1f) x = sign | 0x7f800000 | (mant << 13);
+    else if (exp != 0) x = sign | ((exp + 112) << 23) | (mant << 13);
+    else if (mant == 0) x = sign;
+    else {
+        u32 e = 0;
+        do {
+            ++e;
+            mant <<= 1;
+        } while (!(mant & 0x400));
+        x = sign | ((113 - e) << 23) | ((mant & 0x3ff) << 13);
+    }
+
+    f32 res;
+    std::memcpy(&res, &x, sizeof(res));
+    return res;
+#endif
+}
+
+inline bf16 to_bf16(f32 v) {
+    u32 x;
+    std::memcpy(&x, &v, sizeof(x));
+    if ((x & 0x7fffffff) > 0x7f800000) return { (u16)((x >> 16) | 0x40) };
+    return { (u16)((x + 0x7fff + ((x >> 16) & 1)) >> 16) };
+}
+
+inline f32 to_f32(bf16 h) {
+    const u32 x = (u32)h.bits << 16;
+    f32 res;
+    std::memcpy(&res, &x, sizeof(res));
+    return res;
+}
+
+template<typename H> H to_half(f32 v);
+template<> inline f16 to_half<f16>(f32 v) { return to_f16(v); }
+template<> inline bf16 to_half<bf16>(f32 v) { return to_bf16(v); }
+
+template<typename H> void convert(const f32 *src, H *dst, u32 n) {
+    for (u32 i = 0; i < n; ++i) dst[i] = to_half<H>(src[i]);
+}
+template<typename H> void convert(const H *src, f32 *dst, u32 n) {
+    for (u32 i = 0; i < n; ++i) dst[i] = to_f32(src[i]);
+}
+
+#if defined(HALF_F16C)
+__attribute__((target("avx,f16c"))) inline void convert_f16c(const f32 *src, f16 *dst, u32 n) {
+    u32 i = 0;
+    for (; i + 8 <= n; i += 8) _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm256_cvtps_ph(_mm256_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT));
+    for (; i < n; ++i) dst[i] = to_f16(src[i]);
+}
+__attribute__((target("avx,f16c"))) inline void convert_f16c(const f16 *src, f32 *dst, u32 n) {
+    u32 i = 0;
+    for (; i + 8 <= n; i += 8) _mm256_storeu_ps(dst + i, _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i))));
+    for (; i < n; ++i) dst[i] = to_f32(src[i]);
+}
+inline bool has_f16c() {
+    static const bool res = __builtin_cpu_supports("f16c");
+    return res;
+}
+
+template<> inline void convert<f16>(const f32 *src, f16 *dst, u32 n) {
+    if (has_f16c()) return convert_f16c(src, dst, n);
+    for (u32 i = 0; i < n; ++i) dst[i] = to_f16(src[i]);
+}
+template<> inline void convert<f16>(const f16 *src, f32 *dst, u32 n) {
+    if (has_f16c()) return convert_f16c(src, dst, n);
+    for (u32 i = 0; i < n; ++i) dst[i] = to_f32(src[i]);
+}
+#endif
+
+template<typename H, u32 D> void to_half_into(Tensor<H, D> &res, const Tensor<f32, D> &x) {
+    if (res.size() != x.size() || res.rows() != x.rows()) {
+        THROW(std::runtime_error, "to_half incompatible sizes");
+        return;
+    }
+    for (u32 r = 0; r < x.rows(); ++r) convert(x.row(r), res.row(r), x.template dim<D - 1>());
+}
+template<typename H, u32 D> Tensor<H, D> to_half(const Tensor<f32, D> &x) {
+    auto res = Tensor<H, D>::alloc_dims(default_alloc_policy, x.shape());
+    to_half_into(res, x);
+    return res;
+}
+
+template<typename H, u32 D> void to_float_into(Tensor<f32, D> &res, const Tensor<H, D> &x) {
+    if (res.size() != x.size() || res.rows() != x.rows()) {
+        THROW(std::runtime_error, "to_float incompatible sizes");
+        return;
+    }
+    for (u32 r = 0; r < x.rows(); ++r) convert(x.row(r), res.row(r), x.template dim<D - 1>());
+}
+template<typename H, u32 D> Tensor<f32, D> to_float(const Tensor<H, D> &x) {
+    auto res = Tensor<f32, D>::alloc_dims(default_alloc_policy, x.shape());
+    to_float_into(res, x);
+    return res;
+}
+
+#endif
@@ -0,0 +1,161 @@
+#ifndef A3EM_AI_KERNELS_H
+#define A3EM_AI_KERNELS_H
+
+#include <cmath>
+
+#include "./quant.h"
+
+// int8 kernels for the code aot.py generates from the model. they follow the tflm reference kernels operation for
+// operation (including the rounding) so a compiled model produces the same bytes as the interpreter.
+
+// x * m the way tflm rounds it: a rounding doubling high multiply, then a rounding right shift.
+// multiply_by_quantized_multiplier() rounds once, which differs from this in the last bit now and then.
+inline i32 tflm_multiply(i32 x, QMultiplier m) {
+    const i32 left = m.shift > 0 ? m.shift : 0, right = m.shift > 0 ? 0 : -m.shift;
+    const i32 a = (i32)((u32)x << left), b = m.multiplier;
+    if (a == INT32_MIN && b == INT32_MIN) return INT32_MAX;
+    const i64 ab = (i64)a * b;
+    const i64 nudge = ab >= 0 ? (1 << 30) : 1 - (1 << 30);
+    const i32 high = (i32)((ab + nudge) / ((i64)1 << 31));
+    if (right == 0) return high;
+    const i32 mask = (i32)(((i64)1 << right) - 1), remainder = high & mask, threshold = (mask >> 1) + (high < 0 ? 1 : 0);
+    return (high >> right) + (remainder > threshold ? 1 : 0);
+}
+
+inline void quantize_q8(i8 *dst, const f32 *src, u32 n, f32 scale, i32 zero_point) {
+    for (u32 i = 0; i < n; ++i) dst[i] = (i8)saturate<i8>((i32)std::round(src[i] / scale) + zero_point);
+}
+inline void dequantize_q8(f32 *dst, const i8 *src, u32 n, f32 scale, i32 zero_point) {
+    for (u32 i = 0; i < n; ++i) dst[i] = (f32)((f64)scale * ((i32)src[i] - zero_point));
+}
+
+// nhwc input and output, ohwi filter, one multiplier per output channel
+struct QConv2D {
+    u32 in_h, in_w, in_c;
+    u32 out_h, out_w, out_c;
+    u32 k_h, k_w;
+    u32 stride_h, stride_w;
+    u32 dilation_h, dilation_w;
+    u32 pad_h, pad_w;
+    i32 in_zero_point, out_zero_point;
+    i32 act_min, act_max;
+};
+
+// leaky relu parameters for one int8 tensor pair; identity scales the non-negative side, alpha the negative one
+struct QLeakyRelu {
+    i32 in_zero_point, out_zero_point;
+    QMultiplier identity, alpha;
+};
+
+inline i8 leaky_relu_q8(i8 x, const QLeakyRelu &l) {
+    const i32 v = (i32)x - l.in_zero_point;
+    return (i8)saturate<i8>(l.out_zero_point + tflm_multiply(v, v >= 0 ? l.identity : l.alpha));
+}
+
+// conv2d_q8 with f applied to each output pixel's channels while they are still hot, so an elementwise op after the
+// conv needs no pass of its own over the map. f runs in a loop of its own over the channels so it still vectorizes.
+template<typename F>
+inline void conv2d_map_q8(i8 *out, const i8 *in, const i8 *filter, const i32 *bias, const QMultiplier *mult, QConv2D p, F f) {
+    for (u32 oy = 0; oy < p.out_h; ++oy) {
+        for (u32 ox = 0; ox < p.out_w; ++ox) {
+            const i32 y0 = (i32)(oy * p.stride_h) - (i32)p.pad_h, x0 = (i32)(ox * p.stride_w) - (i32)p.pad_w;
+            i8 *const pixel = out + (oy * p.out_w + ox) * p.out_c;
+            for (u32 oc = 0; oc < p.out_c; ++oc) {
+                const i8 *w0 = filter + oc * p.k_h * p.k_w * p.in_c;
+                i32 acc = 0;
+                for (u32 ky = 0; ky < p.k_h; ++ky) {
+                    const i32 y = y0 + (i32)(ky * p.dilation_h);
+                    if (y < 0 || y >= (i32)p.in_h) continue;
+                    for (u32 kx = 0; kx < p.k_w; ++kx) {
+                        const i32 x = x0 + (i32)(kx * p.dilation_w);
+                        if (x < 0 || x >= (i32)p.in_w) continue;
+                        const i8 *src = in + ((u32)y * p.in_w + (u32)x) * p.in_c, *w = w0 + (ky * p.k_w + kx) * p.in_c;
+                        for (u32 c = 0; c < p.in_c; ++c) acc += (i32)w[c] * ((i32)src[c] - p.in_zero_point);
+                    }
+                }
+                if (bias) acc += bias[oc];
+                acc = tflm_multiply(acc, mult[oc]) + p.out_zero_point;
+                pixel[oc] = (i8)std::min(std::max(acc, p.act_min), p.act_max);
+            }
+            for (u32 oc = 0; oc < p.out_c; ++oc) pixel[oc] = f(pixel[oc]);
+        }
+    }
+}
+
+inline void conv2d_q8(i8 *out, const i8 *in, const i8 *filter, const i32 *bias, const QMultiplier *mult, const QConv2D &p) {
+    conv2d_map_q8(out, in, filter, bias, mult, p, [](i8 v) { return v; });
+}
+// the conv into its own output quantization, then the leaky relu from there: the bytes of conv2d_q8 followed by
+// leaky_relu_q8, without the intermediate map
+inline void conv2d_leaky_q8(i8 *out, const i8 *in, const i8 *filter, const i32 *bias, const QMultiplier *mult, const QConv2D &p, const QLeakyRelu &l) {
+    conv2d_map_q8(out, in, filter, bias, mult, p, [&](i8 v) { return leaky_relu_q8(v, l); });
+}
+
+// one output column (out_h x out_c) of conv2d_map_q8 from the k_w input columns (in_h x in_c each, oldest first) it reads.
+// the columns don't have to be adjacent in memory, so streaming code can keep them in rings. no padding along w.
+template<typename F>
+inline void conv2d_column_map_q8(i8 *out, const i8 *const *in, const i8 *filter, const i32 *bias, const QMultiplier *mult, QConv2D p, F f) {
+    for (u32 oy = 0; oy < p.out_h; ++oy) {
+        const i32 y0 = (i32)(oy * p.stride_h) - (i32)p.pad_h;
+        i8 *const pixel = out + oy * p.out_c;
+        for (u32 oc = 0; oc < p.out_c; ++oc) {
+            const i8 *w0 = filter + oc * p.k_h * p.k_w * p.in_c;
+            i32 acc = 0;
+            for (u32 ky = 0; ky < p.k_h; ++ky) {
+                const i32 y = y0 + (i32)(ky * p.dilation_h);
+                if (y < 0 || y >= (i32)p.in_h) continue;
+                for (u32 kx = 0; kx < p.k_w; ++kx) {
+                    const i8 *src = in[kx * p.dilation_w] + (u32)y * p.in_c, *w = w0 + (ky * p.k_w + kx) * p.in_c;
+                    for (u32 c = 0; c < p.in_c; ++c) acc += (i32)w[c] * ((i32)src[c] - p.in_zero_point);
+                }
+            }
+            if (bias) acc += bias[oc];
+            acc = tflm_multiply(acc, mult[oc]) + p.out_zero_point;
+            pixel[oc] = (i8)std::min(std::max(acc, p.act_min), p.act_max);
+        }
+        for (u32 oc = 0; oc < p.out_c; ++oc) pixel[oc] = f(pixel[oc]);
+    }
+}
+
+inline void conv2d_column_q8(i8 *out, const i8 *const *in, const i8 *filter, const i32 *bias, const QMultiplier *mult, const QConv2D &p) {
+    conv2d_column_map_q8(out, in, filter, bias, mult, p, [](i8 v) { return v; });
+}
+inline void conv2d_column_leaky_q8(i8 *out, const i8 *const *in, const i8 *filter, const i32 *bias, const QMultiplier *mult, const QConv2D &p, const QLeakyRelu &l) {
+    conv2d_column_map_q8(out, in, filter, bias, mult, p, [&](i8 v) { return leaky_relu_q8(v, l); });
+}
+
+// out may be in
+inline void leaky_relu_q8(i8 *out, const i8 *in, u32 n, i32 in_zero_point, i32 out_zero_point, QMultiplier identity, QMultiplier alpha) {
+    const QLeakyRelu l = { in_zero_point, out_zero_point, identity, alpha };
+    for (u32 i = 0; i < n; ++i) out[i] = leaky_relu_q8(in[i], l);
+}
+
+// out(i0, i1, i2, i3) = in(...) with out dimension k taken from in dimension perm[k]; shorter shapes pad with leading 1s
+inline void transpose_q8(i8 *out, const i8 *in, const u32 (&dims)[4], const u32 (&perm)[4]) {
+    u32 stride[4];
+    stride[3] = 1;
+    for (u32 k = 3; k > 0; --k) stride[k - 1] = stride[k] * dims[k];
+    const u32 od[4] = { dims[perm[0]], dims[perm[1]], dims[perm[2]], dims[perm[3]] };
+    const u32 os[4] = { stride[perm[0]], stride[perm[1]], stride[perm[2]], stride[perm[3]] };
+    for (u32 a = 0; a < od[0]; ++a) {
+        for (u32 b = 0; b < od[1]; ++b) {
+            for (u32 c = 0; c < od[2]; ++c) {
+                const i8 *src = in + a * os[0] + b * os[1] + c * os[2];
+                for (u32 d = 0; d < od[3]; ++d) *out++ = src[d * os[3]];
+            }
+        }
+    }
+}
+
+// out[o] = weights[o] . in over a row-major out_n x in_n weight matrix with per-tensor quantization
+inline void fully_connected_q8(i8 *out, const i8 *in, const i8 *weights, const i32 *bias, u32 in_n, u32 out_n,
+                               i32 in_zero_point, i32 weights_zero_point, i32 out_zero_point, QMultiplier mult, i32 act_min, i32 act_max) {
+    for (u32 o = 0; o < out_n; ++o) {
+        i32 acc = qdot(weights + o * in_n, weights_zero_point, in, in_zero_point, in_n);
+        if (bias) acc += bias[o];
+        acc = tflm_multiply(acc, mult) + out_zero_point;
+        out[o] = (i8)std::min(std::max(acc, act_min), act_max);
+    }
+}
+
+#endif
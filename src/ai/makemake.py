@@ -2,6 +2,13 @@ import os
 
 build_dir = 'build'
 
+programs = ['test.cpp', 'bench.cpp', 'arena.cpp']
+
+# programs built again with extra flags: name -> (program, flags, sources those flags change, which get their own objects)
+variants = {
+    'test_zero_heap': ('test.cpp', '-DZERO_HEAP', ['pool.cpp']),
+}
+
 inc = [
     'tflite-micro/',
     'flatbuffers/include/',
@@ -66,14 +73,26 @@ with open('Makefile', 'w') as f:
 
     cxx = f'$(CCPP) {" ".join(f"-I{x}" for x in inc)}'
 
-    all_objs = " ".join(f"{build_dir}/{x[:x.rfind('.')]}.o" for x in src if x != "test.cpp")
+    all_objs = " ".join(f"{build_dir}/{x[:x.rfind('.')]}.o" for x in src if x not in programs)
     f.write(f'all: {all_objs}\n')
-    f.write(f'test: all {build_dir}/test.o\n\t{cxx} {build_dir}/test.o {all_objs} -o test\n')
+    for prog in programs:
+        name = prog[:prog.rfind('.')]
+        f.write(f'{name}: all {build_dir}/{name}.o\n\t{cxx} {build_dir}/{name}.o {all_objs} -pthread -o {name}\n')
 
-    f.write(f'clean:\n\trm -rf {build_dir} test\n')
+    for name, (prog, flags, changed) in variants.items():
+        var_objs = " ".join(f"{build_dir}/{name}/{x[:x.rfind('.')]}.o" for x in [prog] + changed)
+        rest = " ".join(f"{build_dir}/{x[:x.rfind('.')]}.o" for x in src if x not in programs and x not in changed)
+        f.write(f'{name}: all {var_objs}\n\t{cxx} {var_objs} {rest} -pthread -o {name}\n')
+
+    f.write(f'clean:\n\trm -rf {build_dir} {" ".join(x[:x.rfind(".")] for x in programs)} {" ".join(variants)}\n')
 
     for src in src:
         src_dir = src[:src.rfind('/')]
         src_no_ext = src[:src.rfind('.')]
 
         f.write(f'{build_dir}/{src_no_ext}.o: {src}\n\t@echo " Compiling" {src} && mkdir -p {build_dir}/{src_dir} && {cxx} {src} -c -o build/{src_no_ext}.o\n')
+
+    for name, (prog, flags, changed) in variants.items():
+        for x in [prog] + changed:
+            x_no_ext = x[:x.rfind('.')]
+            f.write(f'{build_dir}/{name}/{x_no_ext}.o: {x}\n\t@echo " Compiling" {x} {flags} && mkdir -p {build_dir}/{name} && {cxx} {flags} {x} -c -o {build_dir}/{name}/{x_no_ext}.o\n')
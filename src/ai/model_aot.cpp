@@ -0,0 +1,610 @@
+// generated by aot.py from model.cpp, do not edit
+#include <cstring>
+
+#include "./aot.h"
+#include "./kernels.h"
+#include "./pool.h"
+
+alignas(4) static const i8 conv2_filter[72] = {
+    -127, -69, -51, -40, 75, -27, 112, 58, 78, -62, -10, -33, 87, 32, -11, 117,
+    127, 35, -64, -1, -127, -9, -52, -25, 16, 28, 27, 14, -88, -90, 79, 44,
+    127, -44, -28, 20, 93, 126, 107, 127, 78, 81, -70, -14, 10, 29, 98, 115,
+    89, 127, 14, -34, -72, -81, 67, -60, 14, -52, -19, -65, -56, -22, -127, 127,
+    63, 119, -18, 122, 80, 78, 121, 56,
+};
+alignas(4) static const i32 conv2_bias[8] = {
+    2690, 290, -14345, -16430, -809, -8717, 5566, 8118,
+};
+static const QMultiplier conv2_mult[8] = { { 1463148840, -9 }, { 1455404653, -9 }, { 1888239214, -9 }, { 1847653182, -9 }, { 1524258540, -9 }, { 1206725905, -9 }, { 1672113920, -9 }, { 1109637227, -9 } };
+static constexpr QConv2D conv2 = { 16, 65, 1, 14, 32, 8, 3, 3, 1, 2, 1, 1, 0, 0, -1, 6, -128, 127 };
+static constexpr QLeakyRelu conv2_leaky = { 6, -125, { 1118576256, 2 }, { 1431777536, -5 } };
+alignas(4) static const i8 conv3_filter[128] = {
+    127, 98, 46, -25, 79, 40, -95, 42, 1, -110, -40, 81, -127, -102, 1, -109,
+    21, -41, 8, 73, -61, 127, 59, 12, 44, 22, -127, 70, -2, 25, -16, -36,
+    -98, -33, -24, 23, 55, 127, -67, -26, -26, -96, -50, 23, -127, 3, -24, -89,
+    99, 7, 63, 126, 127, 14, -17, 125, -11, -127, -63, 38, -20, 7, 86, -42,
+    -85, 21, 48, 69, 62, 127, 60, -120, -84, 4, 23, -127, -104, 45, 42, -4,
+    11, 32, -54, 56, -95, 91, 62, -127, 77, -57, -76, 127, -92, -11, 6, -15,
+    112, 8, 127, 82, -13, 54, -24, 28, -109, -75, -127, 7, -105, -113, 6, 25,
+    37, 102, 127, 52, 32, 75, -18, 91, 41, -52, -127, 66, 0, 65, 66, -127,
+};
+alignas(4) static const i32 conv3_bias[16] = {
+    562, -466, -17234, 4826, -4917, -2863, -2221, 3222,
+    4559, -8736, 5057, 294, 2377, -5937, 904, -393,
+};
+static const QMultiplier conv3_mult[16] = { { 1824830247, -9 }, { 1392003094, -8 }, { 2038862639, -10 }, { 1653698915, -8 }, { 1169508027, -8 }, { 1450342665, -9 }, { 1815943313, -9 }, { 1237313845, -8 }, { 1195624563, -9 }, { 1958452106, -9 }, { 1950634450, -9 }, { 1078203624, -8 }, { 1148956548, -8 }, { 1867023198, -9 }, { 1529878211, -9 }, { 1250824830, -8 } };
+static constexpr QConv2D conv3 = { 14, 32, 8, 14, 32, 16, 1, 1, 1, 1, 1, 1, 0, 0, -125, 40, -128, 127 };
+static constexpr QLeakyRelu conv3_leaky = { 40, -123, { 1549908992, 2 }, { 1983883392, -5 } };
+alignas(4) static const i8 conv4_filter[128] = {
+    -19, 127, -58, 107, -53, -37, -35, 44, 29, -67, 75, 91, -1, 2, 6, 52,
+    -51, 127, 56, 96, -67, 49, 28, 59, 36, 29, 35, 42, -42, 57, -35, 118,
+    70, -8, 45, -32, 106, -93, 127, -123, -64, -69, -30, -78, -4, -86, 53, 62,
+    59, -55, -7, -52, 63, -11, 76, -21, 10, -35, -34, -15, 76, -77, 127, 70,
+    90, 127, -78, 32, -93, -33, -76, 120, 115, 13, 45, -37, -24, -61, -60, 39,
+    -70, -92, -5, -88, 127, -16, -8, 0, -11, 34, -43, -83, -70, 37, -21, -46,
+    -10, -94, 54, -94, -15, 0, -17, 49, -49, 1, -4, -87, -41, 59, -60, -127,
+    58, 98, 5, 87, -127, -9, 4, -81, 36, -20, 67, 80, 79, -11, 50, 105,
+};
+alignas(4) static const i32 conv4_bias[8] = {
+    7825, -10524, 7648, 5958, 5505, -4908, -9693, -3124,
+};
+static const QMultiplier conv4_mult[8] = { { 1527963214, -9 }, { 1768466314, -9 }, { 1230372960, -9 }, { 1188497689, -9 }, { 1798845695, -10 }, { 1262089185, -8 }, { 1908152733, -9 }, { 1938306695, -9 } };
+static constexpr QConv2D conv4 = { 14, 32, 16, 14, 32, 8, 1, 1, 1, 1, 1, 1, 0, 0, -123, 18, -128, 127 };
+static constexpr QLeakyRelu conv4_leaky = { 18, -125, { 1244781184, 2 }, { 1593320064, -5 } };
+alignas(4) static const i8 conv5_filter[32] = {
+    -58, -127, -39, -109, -105, -7, 22, -98, 112, 127, -29, -12, 46, -37, -58, 1,
+    0, -127, 46, 97, -36, -30, -39, 29, 64, 127, -21, 9, 61, -95, 12, 103,
+};
+alignas(4) static const i32 conv5_bias[4] = {
+    -2881, 5557, 2108, 3437,
+};
+static const QMultiplier conv5_mult[4] = { { 2074186489, -9 }, { 1374992678, -8 }, { 1513120756, -8 }, { 1390256751, -8 } };
+static constexpr QConv2D conv5 = { 14, 32, 8, 14, 32, 4, 1, 1, 1, 1, 1, 1, 0, 0, -125, -14, -128, 127 };
+static constexpr QLeakyRelu conv5_leaky = { -14, -126, { 1920925056, 1 }, { 1229392000, -5 } };
+alignas(4) static const i8 conv6_filter[288] = {
+    30, -65, -4, -37, 68, -127, -28, -116, 81, -80, -10, -67, 6, -63, 26, -19,
+    20, -92, 78, 58, 21, -53, 52, 12, -97, 21, 53, 107, -80, 9, 72, 120,
+    -39, -14, 18, 69, -13, 20, -22, -4, -13, 45, -12, 37, -22, 17, -9, 37,
+    15, -91, -49, -43, 38, -63, -64, -64, 42, -79, -52, -36, 38, -109, 0, -57,
+    4, -113, 2, -30, 20, -127, -14, -34, 25, 99, -61, 87, -4, 82, -15, 104,
+    -8, 127, -53, 92, -37, 22, -38, 56, -42, 79, -32, 68, -1, 35, -1, 58,
+    -32, 2, -21, 30, -48, -15, 18, 56, -109, 56, 22, 98, -11, 112, -107, -1,
+    55, 127, -109, -11, 33, 53, -111, -27, -52, 59, 27, 97, -36, 70, 24, 34,
+    -73, 14, 27, 33, 21, 89, -44, 26, -51, 65, -46, 18, -62, 114, -49, 81,
+    -27, -19, 55, -16, 46, -31, 80, -61, 37, -83, 45, -29, 33, 47, 102, 41,
+    -68, -43, 62, 71, -61, -10, 51, 22, -45, 76, 127, 23, -37, 3, 113, 63,
+    -24, 23, 67, 28, -13, 85, -121, 46, -40, 120, -87, 123, -91, 83, -75, 30,
+    -12, 61, -56, 127, -15, 76, -33, 27, -38, 54, -13, 66, -68, -35, -62, 13,
+    -62, 16, -66, 52, -112, -29, -6, 35, -6, -42, 66, -22, -38, -4, 72, -1,
+    -11, -14, 52, 2, -29, 35, 89, 19, 7, 1, 45, -18, -36, -4, 66, 26,
+    -71, -12, 104, 15, -51, -9, 127, -6, 6, -19, 82, 54, -11, 0, -61, 32,
+    21, 25, -74, 20, 28, 20, -64, -23, -19, 44, -104, 31, -10, 34, -87, 33,
+    -14, 30, -127, 27, 25, -11, -20, -10, 3, 8, -39, -24, -16, -20, -30, -5,
+};
+alignas(4) static const i32 conv6_bias[8] = {
+    -1820, -1344, 621, 4398, 2914, -2598, 607, -1843,
+};
+static const QMultiplier conv6_mult[8] = { { 1341064355, -10 }, { 1416252092, -9 }, { 1375937854, -10 }, { 1591582860, -10 }, { 1245985327, -10 }, { 1315814042, -10 }, { 1583809304, -10 }, { 1274562271, -9 } };
+static constexpr QConv2D conv6 = { 14, 32, 4, 12, 15, 8, 3, 3, 1, 2, 1, 1, 0, 0, -126, 15, -128, 127 };
+static constexpr QLeakyRelu conv6_leaky = { 15, -125, { 1202826368, 2 }, { 1539617664, -5 } };
+alignas(4) static const i8 conv7_filter[128] = {
+    20, -35, 26, 14, -32, 61, -28, 127, -75, -52, 98, 61, -127, 86, -84, 67,
+    34, -127, -107, 50, 127, -120, 58, -84, -127, 51, -59, 37, 4, 37, 10, -92,
+    -23, 38, -81, -127, 11, -13, 49, 0, -127, 92, 26, -20, -16, -4, 43, 96,
+    -23, -63, -21, -127, 51, -47, -7, -91, -89, -58, 66, 40, -2, 89, -38, 127,
+    58, -127, -19, 100, -59, 82, -69, 93, 117, -4, -57, -103, 119, 41, 127, 100,
+    -63, 35, 47, 119, -95, 9, -106, 127, -47, -41, -98, 14, 127, 13, 57, 42,
+    -127, -37, 42, 61, 59, 71, -66, 119, 127, -88, -22, 87, 125, -42, 92, -17,
+    -17, -66, 66, 59, 18, 127, -19, 53, -127, -17, 73, 81, -51, 51, -56, 83,
+};
+alignas(4) static const i32 conv7_bias[16] = {
+    -2413, 768, -1458, -1849, -1055, -2050, 869, -120,
+    2069, 3918, 2776, 1746, -1163, 720, 1528, -897,
+};
+static const QMultiplier conv7_mult[16] = { { 1885110169, -9 }, { 1324787487, -9 }, { 1266879908, -9 }, { 1088301978, -8 }, { 1647619315, -8 }, { 1400713051, -8 }, { 1143045743, -8 }, { 1791022531, -9 }, { 1807197497, -9 }, { 1201070305, -9 }, { 1516524769, -9 }, { 1445872227, -9 }, { 1644148947, -9 }, { 1687773672, -9 }, { 1974356041, -9 }, { 1892753806, -9 } };
+static constexpr QConv2D conv7 = { 12, 15, 8, 12, 15, 16, 1, 1, 1, 1, 1, 1, 0, 0, -125, 26, -128, 127 };
+static constexpr QLeakyRelu conv7_leaky = { 26, -124, { 1331282048, 2 }, { 1704040960, -5 } };
+alignas(4) static const i8 conv8_filter[128] = {
+    19, 56, -22, -4, -21, 127, -98, 54, 30, -15, 59, -12, 56, -24, 39, 47,
+    -43, -72, 3, -42, -127, -68, -31, -14, -20, 23, -35, 0, 5, 30, 5, -70,
+    -48, -87, 79, 12, 72, -53, 122, -127, -2, 76, -102, 104, -111, 10, -78, -116,
+    32, -18, -63, 18, -21, 119, -39, -25, 93, -127, 32, -79, 45, -50, -36, 78,
+    7, -4, 45, -16, 17, -127, 28, 23, 17, 46, -26, 28, 25, 69, 32, -10,
+    -10, 37, -35, -40, -60, 112, -51, 67, -3, -38, 69, -127, 56, -99, -37, 26,
+    64, -30, -84, 36, -48, 81, -127, 51, 65, -23, 13, -24, 24, -17, 54, 19,
+    -5, 8, 50, -47, 116, 1, 127, -82, -62, -27, -27, -29, -115, -65, -4, -75,
+};
+alignas(4) static const i32 conv8_bias[8] = {
+    120, -403, -964, -507, 440, 653, -346, 41,
+};
+static const QMultiplier conv8_mult[8] = { { 1631405127, -9 }, { 1210253486, -8 }, { 1287738258, -9 }, { 1202809509, -9 }, { 2088395388, -9 }, { 1444478856, -9 }, { 1776300669, -9 }, { 1564603501, -9 } };
+static constexpr QConv2D conv8 = { 12, 15, 16, 12, 15, 8, 1, 1, 1, 1, 1, 1, 0, 0, -124, 22, -128, 127 };
+static constexpr QLeakyRelu conv8_leaky = { 22, -124, { 1281459584, 2 }, { 1640268288, -5 } };
+alignas(4) static const i8 conv9_filter[32] = {
+    -21, 42, 47, -66, 127, -70, -96, -50, -127, -6, 88, -20, 32, -45, 13, 24,
+    79, -64, -93, 42, -14, 51, 61, -127, -51, -92, 97, 1, 39, -102, -28, 127,
+};
+alignas(4) static const i32 conv9_bias[4] = {
+    -464, -446, 615, -2929,
+};
+static const QMultiplier conv9_mult[4] = { { 1437090912, -8 }, { 2023897777, -8 }, { 1544730550, -8 }, { 1217865382, -8 } };
+static constexpr QConv2D conv9 = { 12, 15, 8, 12, 15, 4, 1, 1, 1, 1, 1, 1, 0, 0, -124, 7, -128, 127 };
+static constexpr QLeakyRelu conv9_leaky = { 7, -125, { 1128719488, 2 }, { 1444760960, -5 } };
+alignas(4) static const i8 conv10_filter[288] = {
+    -30, -31, 27, -25, -24, -42, -13, -41, -37, -41, -5, -41, 56, 127, -42, 31,
+    71, 100, -12, 29, 67, 107, -33, 24, -24, -55, 70, 84, -16, -44, 61, 42,
+    -5, -61, 74, -1, 36, 46, -97, 3, 7, 22, -98, 14, 34, 23, -127, 23,
+    9, 20, 11, 10, 11, -33, 12, 25, 27, 10, 43, 27, 43, 6, -90, 13,
+    39, 28, -22, 18, 58, 39, -35, 53, 111, 65, -115, 4, 61, 33, -46, -54,
+    127, 13, -118, 21, 42, 38, 13, -86, 98, 0, 39, -10, 100, -32, 41, -19,
+    58, 46, -1, -16, 91, -21, -7, 23, 66, 4, -2, -36, -115, -123, 60, -16,
+    -75, -43, 49, -37, -127, -85, 68, -48, -4, 68, 44, 65, -2, 76, 43, 15,
+    35, 13, 61, 73, -41, 33, 66, 61, -40, -11, 55, 47, -55, 10, 54, 78,
+    -33, -5, -7, 118, 14, 5, -2, 74, -16, -16, 25, 71, 33, 62, -27, 61,
+    27, 73, -16, -2, 87, 57, -22, 39, -45, -26, 29, 127, -92, 24, 10, 80,
+    -65, 3, 16, 101, -15, 5, 9, 21, -3, -1, -6, 12, -18, -19, 5, 3,
+    4, 32, -127, 71, -1, -16, -76, 26, 8, 26, -65, 34, -4, 45, -95, 80,
+    20, 19, -64, 21, 10, 36, -92, 33, -127, -122, 45, -120, -116, -89, 28, -29,
+    -127, -86, 36, -97, 94, 93, 21, 84, 60, 30, 1, 25, 46, 77, 21, 116,
+    11, -10, -63, 17, -24, 52, -25, 1, -39, 23, -67, 32, 127, -41, -38, -81,
+    23, 57, -25, -51, 48, 21, -61, -57, 69, -39, 77, 41, 78, 51, 59, 14,
+    63, -46, 88, 39, 56, 110, -11, 7, 104, 73, 54, -19, 92, 32, 44, -21,
+};
+alignas(4) static const i32 conv10_bias[8] = {
+    908, 255, 1481, -2478, -433, -1633, -2435, 1247,
+};
+static const QMultiplier conv10_mult[8] = { { 1231782762, -9 }, { 1417687458, -9 }, { 1701511198, -10 }, { 1912733594, -10 }, { 1218840038, -9 }, { 1388931477, -8 }, { 1159269992, -9 }, { 1698328266, -10 } };
+static constexpr QConv2D conv10 = { 12, 15, 4, 5, 7, 8, 3, 3, 2, 2, 1, 1, 0, 0, -125, 62, -128, 127 };
+static constexpr QLeakyRelu conv10_leaky = { 62, -121, { 2060256384, 2 }, { 1318564096, -4 } };
+alignas(4) static const i8 conv11_filter[128] = {
+    -1, -73, -29, 8, -44, -39, -127, -16, -107, -15, -27, 49, -8, 127, 55, -32,
+    127, -24, -18, 23, 39, -100, -78, 15, 49, -55, -46, -27, -127, -60, 35, 26,
+    -127, 31, 1, 29, 77, -76, 3, -12, 16, -13, -126, 127, 4, 1, 42, -24,
+    9, 51, 18, 127, 36, 0, -51, 54, 3, 12, 127, -17, 84, 27, -16, 112,
+    111, -30, -127, 127, 25, 118, -20, 9, 2, 8, 26, -81, -127, -81, 14, 114,
+    -15, -17, -91, 127, 18, 48, 68, -64, -48, 10, 31, -89, -36, 71, -127, 25,
+    120, 94, 45, -1, 127, 24, 106, -38, 6, -94, -19, -14, 81, 73, 83, -127,
+    127, -23, 19, 52, 69, 49, 17, -17, -127, 8, 7, 27, -117, -61, 117, 0,
+};
+alignas(4) static const i32 conv11_bias[16] = {
+    -459, -3072, 1767, 757, 1142, -2485, -3589, 2214,
+    -1896, -3438, -724, -367, 625, -1924, 563, 657,
+};
+static const QMultiplier conv11_mult[16] = { { 1530123184, -8 }, { 1531380094, -8 }, { 1156390361, -8 }, { 1422022249, -8 }, { 1202735459, -8 }, { 1527666170, -9 }, { 1666689787, -9 }, { 2090259394, -9 }, { 1747709199, -9 }, { 1458899227, -9 }, { 1918149478, -9 }, { 1643932579, -8 }, { 1148761321, -8 }, { 1339928510, -8 }, { 1076069773, -8 }, { 1987442030, -9 } };
+static constexpr QConv2D conv11 = { 5, 7, 8, 5, 7, 16, 1, 1, 1, 1, 1, 1, 0, 0, -121, -14, -128, 127 };
+static constexpr QLeakyRelu conv11_leaky = { -14, -126, { 1919899136, 1 }, { 1228735360, -5 } };
+alignas(4) static const i8 conv12_filter[128] = {
+    -5, -53, 56, -46, 75, -22, 36, -12, 83, 46, -71, -19, 47, 127, 58, -34,
+    0, 46, 30, -20, 20, -26, -8, 9, 21, -127, 41, -80, 39, -14, 20, -7,
+    6, -21, 60, -127, -92, 33, -39, 44, 13, -56, 13, -85, 63, 92, 71, -103,
+    -99, -45, -3, -91, 24, -24, -61, 39, -8, -12, -4, 27, 109, 45, 19, -127,
+    57, -1, 57, -15, 59, 46, -92, 19, -37, 53, 50, 20, -72, -8, -117, 127,
+    -36, 83, -114, -127, -89, 49, 55, -36, 39, 0, 42, -14, 18, 76, 57, 38,
+    -51, -97, -26, -97, 127, -32, 46, 82, -43, -11, -25, 11, 56, 9, -36, -42,
+    -86, 127, -113, -73, -127, 75, 93, -39, 41, -121, 92, -42, 20, 34, 87, 122,
+};
+alignas(4) static const i32 conv12_bias[8] = {
+    -51, 156, -120, 906, -10, -1522, 514, -1043,
+};
+static const QMultiplier conv12_mult[8] = { { 1115558825, -7 }, { 1647939498, -7 }, { 1805166739, -8 }, { 1917907794, -8 }, { 2088812151, -8 }, { 2072043223, -8 }, { 1076823136, -7 }, { 1606602353, -8 } };
+static constexpr QConv2D conv12 = { 5, 7, 16, 5, 7, 8, 1, 1, 1, 1, 1, 1, 0, 0, -126, -6, -128, 127 };
+static constexpr QLeakyRelu conv12_leaky = { -6, -126, { 2034484736, 1 }, { 1302070144, -5 } };
+alignas(4) static const i8 conv13_filter[32] = {
+    -48, 98, -16, -127, 75, 46, -62, 77, 36, 41, -70, 111, -68, -79, 127, -11,
+    0, -34, -127, -9, 121, -99, 68, -18, 64, 127, 89, -11, -65, 70, -29, 74,
+};
+alignas(4) static const i32 conv13_bias[4] = {
+    3177, -1171, 2271, 2358,
+};
+static const QMultiplier conv13_mult[4] = { { 1163794010, -8 }, { 1994531030, -9 }, { 1272741531, -8 }, { 1119511931, -8 } };
+static constexpr QConv2D conv13 = { 5, 7, 8, 5, 7, 4, 1, 1, 1, 1, 1, 1, 0, 0, -126, -22, -128, 127 };
+static constexpr QLeakyRelu conv13_leaky = { -22, -126, { 1829620864, 1 }, { 1170957440, -5 } };
+alignas(4) static const i8 conv14_filter[288] = {
+    -127, 72, 101, -94, -51, 33, 85, 3, -36, 52, 107, -78, -52, -43, -30, 57,
+    -56, -78, -3, 70, -37, -36, -27, 36, -21, 73, 89, 30, 5, 41, 45, 34,
+    -43, 54, 14, 39, -125, 15, 57, 93, -105, 7, 10, 61, -127, 7, 28, 98,
+    66, 57, 4, -103, 6, 52, -18, -93, 44, 21, 7, -108, 34, -61, -73, 82,
+    60, -43, -41, 42, 52, -14, -88, 66, 7, 36, -62, -86, 47, 65, -80, -4,
+    21, 102, -16, -116, -39, -2, -50, 71, -33, -3, -21, 57, -63, -43, -64, 62,
+    -23, 119, 5, -33, -8, 106, 67, -31, -127, 112, 51, -30, -26, -6, -42, -9,
+    -35, -7, -7, 13, -17, -17, -31, -3, 21, -2, -42, -20, 74, -10, -73, -12,
+    60, 12, -61, -17, 35, -4, 127, 39, 55, 23, 113, 34, 29, -15, 104, 15,
+    -41, 54, 124, -11, 24, 52, 127, -5, -25, 110, 90, -27, 66, 40, 1, 9,
+    73, 45, 39, -8, 20, 0, 54, -24, -20, -24, -20, -15, 22, -66, -1, 26,
+    44, -51, -10, 29, 20, -5, -127, 4, 3, 7, -78, 16, 14, -3, -72, 4,
+    11, -29, 14, -11, 9, -12, 36, -9, 14, -29, 28, -13, -5, 2, -6, 49,
+    -5, -11, 0, 36, 7, -2, -14, 32, 75, -46, -9, 61, 66, 13, 2, 5,
+    38, -31, 14, 76, -88, 95, -4, -21, -52, 49, -41, -15, -127, 82, 10, -4,
+    19, -58, -101, 1, 29, -31, -46, 3, 32, -33, -79, -8, 0, 84, -28, -8,
+    -4, 52, 29, 8, -37, 82, 63, 25, 69, -85, 67, -53, 45, -57, 127, -2,
+    21, -43, 91, -7, 15, -4, -8, 91, 2, -6, -44, 41, -19, -14, -38, 7,
+};
+alignas(4) static const i32 conv14_bias[8] = {
+    3246, 783, 815, -1256, 33, 623, -2971, 4126,
+};
+static const QMultiplier conv14_mult[8] = { { 2040500112, -9 }, { 1731136725, -9 }, { 1938634217, -9 }, { 1527493819, -8 }, { 1123716802, -8 }, { 1589767329, -7 }, { 1225609983, -8 }, { 1732562524, -9 } };
+static constexpr QConv2D conv14 = { 5, 7, 4, 2, 3, 8, 3, 3, 2, 2, 1, 1, 0, 0, -126, -21, -128, 127 };
+static constexpr QLeakyRelu conv14_leaky = { -21, -126, { 1838971392, 1 }, { 1176941696, -5 } };
+alignas(4) static const i8 conv15_filter[128] = {
+    77, 60, 71, -40, 75, -96, 36, 127, -37, 35, -127, -42, -17, -16, 68, -5,
+    -44, -13, 21, -86, -87, -127, -118, -113, 71, -3, -127, -15, 41, 59, -41, 7,
+    -89, 54, 3, 56, -55, -68, 127, -25, -25, 113, 7, 86, 98, -127, -54, 4,
+    -127, -75, 92, -66, -110, 27, 111, -119, 7, -85, 42, 75, -47, -8, -37, 127,
+    -33, 3, -127, 95, 56, 29, 123, 14, -65, -22, -50, 127, -38, -93, 57, -50,
+    -109, 16, -39, 54, -34, 127, 109, 125, 107, -98, 127, -94, -8, 37, 78, -31,
+    -15, 127, -57, -63, 11, -13, -53, 46, -97, 111, -100, -37, -49, -80, 127, -10,
+    109, -1, -76, -11, -67, -58, -100, 127, 48, 67, -104, -97, 64, 127, -56, 35,
+};
+alignas(4) static const i32 conv15_bias[16] = {
+    1362, -254, -1912, 1191, -288, 1005, -1738, 2792,
+    -2354, 9314, -8180, 2497, 9767, -3470, -1170, 4450,
+};
+static const QMultiplier conv15_mult[16] = { { 1411628749, -8 }, { 1529651441, -7 }, { 1510651384, -8 }, { 1526415786, -8 }, { 1862785699, -8 }, { 1652503803, -8 }, { 1322413408, -8 }, { 1823196651, -8 }, { 1506296063, -8 }, { 1743670441, -9 }, { 1236377828, -8 }, { 1239094598, -8 }, { 1075828532, -8 }, { 1796233990, -8 }, { 1613677639, -8 }, { 1979215273, -9 } };
+static constexpr QConv2D conv15 = { 2, 3, 8, 2, 3, 16, 1, 1, 1, 1, 1, 1, 0, 0, -126, 32, -128, 127 };
+static constexpr QLeakyRelu conv15_leaky = { 32, -124, { 1416631552, 2 }, { 1813288320, -5 } };
+alignas(4) static const i8 conv16_filter[128] = {
+    51, 7, -8, -29, 21, 113, 6, -39, 55, 16, -35, -30, 9, 127, 66, 31,
+    -60, 3, -15, -27, 14, 32, 127, 20, -21, -98, 57, -4, -120, 55, -112, 46,
+    102, -67, -25, -127, -78, 80, 25, 123, 41, 97, -110, -46, 115, 35, 124, 66,
+    -60, -42, -31, 38, 55, 46, -5, -18, 56, -1, -38, -26, 5, 79, 127, 2,
+    -38, 18, -127, 107, 7, 59, 69, 16, -15, -7, 59, 72, 105, 51, -36, 86,
+    -15, 67, -70, 25, -83, 69, 5, 19, -51, 93, 28, -18, -53, -127, 62, -53,
+    19, -62, 5, 12, 5, -4, 1, -9, -34, 42, 15, 31, 7, -127, -12, -10,
+    34, -5, -53, 27, 13, 9, -127, 27, -102, 84, -47, 29, -10, -105, 52, -20,
+};
+alignas(4) static const i32 conv16_bias[8] = {
+    7626, -1487, 2851, 655, 8124, -2461, 1333, -946,
+};
+static const QMultiplier conv16_mult[8] = { { 1442310409, -9 }, { 1794355207, -9 }, { 1382928121, -9 }, { 1335422670, -8 }, { 1447766639, -9 }, { 1528360971, -9 }, { 1102386063, -7 }, { 1215260038, -8 } };
+static constexpr QConv2D conv16 = { 2, 3, 16, 2, 3, 8, 1, 1, 1, 1, 1, 1, 0, 0, -124, 38, -128, 127 };
+static constexpr QLeakyRelu conv16_leaky = { 38, -123, { 1517914880, 2 }, { 1942930944, -5 } };
+alignas(4) static const i8 conv17_filter[32] = {
+    80, -107, 127, -2, 26, 42, -76, -39, 58, 48, 17, 57, 100, -127, 17, -11,
+    -46, 6, 106, 5, -73, 102, -127, 64, 23, -36, 34, -127, 60, 101, 120, 112,
+};
+alignas(4) static const i32 conv17_bias[4] = {
+    -2125, 3888, -8369, -645,
+};
+static const QMultiplier conv17_mult[4] = { { 1642489438, -8 }, { 1581069391, -8 }, { 1198182764, -7 }, { 1677898420, -8 } };
+static constexpr QConv2D conv17 = { 2, 3, 8, 2, 3, 4, 1, 1, 1, 1, 1, 1, 0, 0, -123, -3, -128, 127 };
+static constexpr QLeakyRelu conv17_leaky = { -3, -126, { 2083888896, 1 }, { 1333688832, -5 } };
+alignas(4) static const i8 fc20_weights[384] = {
+    64, 43, 72, 29, 1, 10, -12, -1, 5, 50, 61, 70, 53, 102, 76, -40,
+    -57, -88, -74, -79, -98, -67, -2, -48, 0, -8, 8, -8, 10, -11, 1, 10,
+    -7, 5, -29, 17, 11, 19, -31, 26, 46, 13, 4, -7, 3, 3, 2, -6,
+    5, -10, 4, 10, -6, 1, -9, 19, -12, -15, 24, -3, 1, -11, 21, 24,
+    42, 20, 0, 3, -3, -2, -3, 3, -10, 7, -2, -19, 6, -3, 12, 3,
+    -4, 26, -13, 1, 67, -12, 52, -22, -36, 16, -5, 14, -8, 12, -19, 7,
+    -12, 20, -8, -9, 17, 18, 16, -28, 9, 24, -30, -20, -10, -39, -27, -2,
+    10, -37, -4, 8, -5, -2, 2, -5, 6, 2, -11, -4, 14, -12, -19, 7,
+    18, -1, -21, 23, 43, 21, 60, -11, 34, -1, -7, 5, 3, 3, -3, -3,
+    10, -12, 5, 4, 7, -5, -16, 29, -18, -3, -9, 13, -11, -13, 1, 33,
+    5, 12, -6, 13, -8, 0, -4, 5, -6, -1, 5, 9, -17, 15, 16, -7,
+    0, -25, 24, -25, -34, 12, -29, -49, 23, -21, 11, -22, 12, 7, 1, -9,
+    -3, 0, 5, -2, 8, 6, 5, -3, -6, 14, -14, 1, 32, -26, 5, 29,
+    -28, 19, 1, -2, 1, -1, 5, -5, -2, 0, 5, 13, -2, -2, 5, 0,
+    -7, -20, -16, 6, -10, -37, -20, -18, -38, -13, 3, -3, 0, -7, 15, -6,
+    -3, 4, 0, 16, -6, 11, 0, -3, -2, -21, 6, -3, 26, -41, -17, -14,
+    27, -7, -5, 8, -4, 0, 6, -7, 0, 7, 2, -3, 19, 8, -4, -1,
+    -5, 12, -29, -20, -39, -3, -41, 28, -16, -22, 1, -5, 1, 3, -1, 3,
+    -127, -57, -125, -49, -31, -28, 53, 61, 57, 65, 18, 18, -108, -37, -122, -9,
+    -46, -70, -83, -56, -107, 59, 53, 70, -1, -5, 7, 1, 14, 4, -2, 11,
+    -15, 7, -16, 4, 34, -12, -26, 32, 3, 32, -1, 3, -3, 2, -4, 1,
+    -1, -4, 6, -8, 4, -7, 8, 3, -7, 13, -24, 5, 19, 35, -45, 0,
+    -12, 36, 5, -5, 1, -5, 8, -2, -6, -9, 14, 2, -24, 4, 14, 7,
+    -15, -11, 23, 1, 67, 20, 41, 39, 3, 13, 2, -3, 0, 5, 14, -16,
+};
+alignas(4) static const i32 fc20_bias[16] = {
+    -2473, 727, -302, -1076, 1795, 170, -153, 1085,
+    -226, 1875, 1018, 2137, 2736, 434, 457, -681,
+};
+
+// the model needs 10752 bytes; builds can make it larger so the frontend plan fits in the scratch
+#ifndef AOT_ARENA_SIZE
+#define AOT_ARENA_SIZE 10752
+#endif
+static_assert(AOT_ARENA_SIZE >= 10752, "AOT_ARENA_SIZE too small for the model");
+
+constexpr u32 aot_arena_size = AOT_ARENA_SIZE;
+alignas(TENSOR_ALIGN) static i8 arena[aot_arena_size];
+alignas(TENSOR_ALIGN) static f32 input[16 * 65];
+static f32 output[16];
+
+static void run_quantized(f32 *y) {
+    // transpose_11
+    // reshape: same bytes, nothing to do
+    // transpose_4
+    conv2d_leaky_q8(arena + 7168, arena, conv2_filter, conv2_bias, conv2_mult, conv2, conv2_leaky);
+    // transpose_7
+    conv2d_leaky_q8(arena, arena + 7168, conv3_filter, conv3_bias, conv3_mult, conv3, conv3_leaky);
+    // transpose_10
+    conv2d_leaky_q8(arena + 7168, arena, conv4_filter, conv4_bias, conv4_mult, conv4, conv4_leaky);
+    // transpose_13
+    conv2d_leaky_q8(arena, arena + 7168, conv5_filter, conv5_bias, conv5_mult, conv5, conv5_leaky);
+    // transpose_16
+    conv2d_leaky_q8(arena + 2880, arena, conv6_filter, conv6_bias, conv6_mult, conv6, conv6_leaky);
+    // transpose_19
+    conv2d_leaky_q8(arena, arena + 2880, conv7_filter, conv7_bias, conv7_mult, conv7, conv7_leaky);
+    // transpose_22
+    conv2d_leaky_q8(arena + 2880, arena, conv8_filter, conv8_bias, conv8_mult, conv8, conv8_leaky);
+    // transpose_25
+    conv2d_leaky_q8(arena, arena + 2880, conv9_filter, conv9_bias, conv9_mult, conv9, conv9_leaky);
+    // transpose_28
+    conv2d_leaky_q8(arena + 720, arena, conv10_filter, conv10_bias, conv10_mult, conv10, conv10_leaky);
+    // transpose_31
+    conv2d_leaky_q8(arena, arena + 720, conv11_filter, conv11_bias, conv11_mult, conv11, conv11_leaky);
+    // transpose_34
+    conv2d_leaky_q8(arena + 560, arena, conv12_filter, conv12_bias, conv12_mult, conv12, conv12_leaky);
+    // transpose_37
+    conv2d_leaky_q8(arena, arena + 560, conv13_filter, conv13_bias, conv13_mult, conv13, conv13_leaky);
+    // transpose_40
+    conv2d_leaky_q8(arena + 144, arena, conv14_filter, conv14_bias, conv14_mult, conv14, conv14_leaky);
+    // transpose_43
+    conv2d_leaky_q8(arena, arena + 144, conv15_filter, conv15_bias, conv15_mult, conv15, conv15_leaky);
+    // transpose_46
+    conv2d_leaky_q8(arena + 96, arena, conv16_filter, conv16_bias, conv16_mult, conv16, conv16_leaky);
+    // Add_16;convolution_15;Const_2
+    conv2d_leaky_q8(arena, arena + 96, conv17_filter, conv17_bias, conv17_mult, conv17, conv17_leaky);
+    // onnx_tf_prefix_/LeakyRelu_15
+    transpose_q8(arena + 32, arena, { 1, 2, 3, 4 }, { 0, 3, 1, 2 });
+    // flatten/Reshape;onnx_tf_prefix_/Reshape_1
+    // reshape: same bytes, nothing to do
+    // PartitionedCall:01
+    fully_connected_q8(arena, arena + 32, fc20_weights, fc20_bias, 24, 16, -126, 0, -5, { 1347165089, -8 }, -128, 127);
+    // PartitionedCall:0
+    dequantize_q8(y, arena, 16, 0.031162980943918228f, -5);
+}
+
+static void run(const Tensor<f32, 2> &x, f32 *y) {
+    for (u32 i = 0; i < 16; ++i) quantize_q8(arena + i * 65, x.row(i), 65, 0.007843137718737125f, -1);
+    run_quantized(y);
+}
+
+u32 aot_output_size() {
+    return 16;
+}
+
+// everything after the quantized input, which the frontend fills while it works in the scratch
+ArenaScratch aot_scratch() {
+    return { reinterpret_cast<u8*>(arena) + 1040, aot_arena_size - 1040 };
+}
+
+Tensor<f32, 2> aot_input() {
+    return { input, nullptr, 16, 65 };
+}
+
+Tensor<f32, 1> aot_output() {
+    return { output, nullptr, 16 };
+}
+
+Status aot_invoke() {
+    StageScope stage(STAGE_INFERENCE);
+    run(aot_input(), output);
+    return Status{ nullptr };
+}
+
+QTensor<i8, 2> aot_input_q8() {
+    return { Tensor<i8, 2> { arena, nullptr, 16, 65 }, { 0.007843137718737125f, -1 } };
+}
+
+Status aot_invoke_q8() {
+    StageScope stage(STAGE_INFERENCE);
+    run_quantized(output);
+    return Status{ nullptr };
+}
+
+Status aot_inference_into(Tensor<f32, 1> &res, const Tensor<f32, 2> &x) {
+    StageScope stage(STAGE_INFERENCE);
+    if (x.dim<0>() != 16 || x.dim<1>() != 65) {
+        THROW(std::runtime_error, "input wrong shape");
+        return take_error();
+    }
+    if (res.dim<0>() != 16) {
+        THROW(std::runtime_error, "output wrong shape");
+        return take_error();
+    }
+
+    run(x, res.row(0));
+    return Status{ nullptr };
+}
+
+Tensor<f32, 1> aot_inference(const Tensor<f32, 2> &x) {
+    StageScope stage(STAGE_INFERENCE);
+    auto res = Tensor<f32, 1>::alloc(16);
+    if (!aot_inference_into(res, x).ok()) return {};
+    return res;
+}
+
+// the conv stack a column at a time: a ring of input columns per strided conv, the newest 3 output columns
+static i8 stream_ring0[3][16];
+static i8 stream_ring1[3][56];
+static i8 stream_ring2[3][48];
+static i8 stream_ring3[3][20];
+static u32 stream_seen[4];
+alignas(4) static i8 stream_a[224], stream_b[224];
+static i8 stream_last[3][8];
+static u32 stream_done;
+
+static void stream_column(const i8 *col) {
+    std::memcpy(stream_ring0[stream_seen[0] % 3], col, 16);
+    if (++stream_seen[0] < 3 || (stream_seen[0] - 3) % 2 != 0) return;
+    {
+        const u32 seen = stream_seen[0];
+        const i8 *const in[3] = { stream_ring0[(seen - 3) % 3], stream_ring0[(seen - 2) % 3], stream_ring0[(seen - 1) % 3] };
+        conv2d_column_leaky_q8(stream_a, in, conv2_filter, conv2_bias, conv2_mult, conv2, conv2_leaky);
+    }
+    {
+        const i8 *const in[1] = { stream_a };
+        conv2d_column_leaky_q8(stream_b, in, conv3_filter, conv3_bias, conv3_mult, conv3, conv3_leaky);
+    }
+    {
+        const i8 *const in[1] = { stream_b };
+        conv2d_column_leaky_q8(stream_a, in, conv4_filter, conv4_bias, conv4_mult, conv4, conv4_leaky);
+    }
+    {
+        const i8 *const in[1] = { stream_a };
+        conv2d_column_leaky_q8(stream_b, in, conv5_filter, conv5_bias, conv5_mult, conv5, conv5_leaky);
+    }
+    std::memcpy(stream_ring1[stream_seen[1] % 3], stream_b, 56);
+    if (++stream_seen[1] < 3 || (stream_seen[1] - 3) % 2 != 0) return;
+    {
+        const u32 seen = stream_seen[1];
+        const i8 *const in[3] = { stream_ring1[(seen - 3) % 3], stream_ring1[(seen - 2) % 3], stream_ring1[(seen - 1) % 3] };
+        conv2d_column_leaky_q8(stream_a, in, conv6_filter, conv6_bias, conv6_mult, conv6, conv6_leaky);
+    }
+    {
+        const i8 *const in[1] = { stream_a };
+        conv2d_column_leaky_q8(stream_b, in, conv7_filter, conv7_bias, conv7_mult, conv7, conv7_leaky);
+    }
+    {
+        const i8 *const in[1] = { stream_b };
+        conv2d_column_leaky_q8(stream_a, in, conv8_filter, conv8_bias, conv8_mult, conv8, conv8_leaky);
+    }
+    {
+        const i8 *const in[1] = { stream_a };
+        conv2d_column_leaky_q8(stream_b, in, conv9_filter, conv9_bias, conv9_mult, conv9, conv9_leaky);
+    }
+    std::memcpy(stream_ring2[stream_seen[2] % 3], stream_b, 48);
+    if (++stream_seen[2] < 3 || (stream_seen[2] - 3) % 2 != 0) return;
+    {
+        const u32 seen = stream_seen[2];
+        const i8 *const in[3] = { stream_ring2[(seen - 3) % 3], stream_ring2[(seen - 2) % 3], stream_ring2[(seen - 1) % 3] };
+        conv2d_column_leaky_q8(stream_a, in, conv10_filter, conv10_bias, conv10_mult, conv10, conv10_leaky);
+    }
+    {
+        const i8 *const in[1] = { stream_a };
+        conv2d_column_leaky_q8(stream_b, in, conv11_filter, conv11_bias, conv11_mult, conv11, conv11_leaky);
+    }
+    {
+        const i8 *const in[1] = { stream_b };
+        conv2d_column_leaky_q8(stream_a, in, conv12_filter, conv12_bias, conv12_mult, conv12, conv12_leaky);
+    }
+    {
+        const i8 *const in[1] = { stream_a };
+        conv2d_column_leaky_q8(stream_b, in, conv13_filter, conv13_bias, conv13_mult, conv13, conv13_leaky);
+    }
+    std::memcpy(stream_ring3[stream_seen[3] % 3], stream_b, 20);
+    if (++stream_seen[3] < 3 || (stream_seen[3] - 3) % 2 != 0) return;
+    {
+        const u32 seen = stream_seen[3];
+        const i8 *const in[3] = { stream_ring3[(seen - 3) % 3], stream_ring3[(seen - 2) % 3], stream_ring3[(seen - 1) % 3] };
+        conv2d_column_leaky_q8(stream_a, in, conv14_filter, conv14_bias, conv14_mult, conv14, conv14_leaky);
+    }
+    {
+        const i8 *const in[1] = { stream_a };
+        conv2d_column_leaky_q8(stream_b, in, conv15_filter, conv15_bias, conv15_mult, conv15, conv15_leaky);
+    }
+    {
+        const i8 *const in[1] = { stream_b };
+        conv2d_column_leaky_q8(stream_a, in, conv16_filter, conv16_bias, conv16_mult, conv16, conv16_leaky);
+    }
+    {
+        const i8 *const in[1] = { stream_a };
+        conv2d_column_leaky_q8(stream_b, in, conv17_filter, conv17_bias, conv17_mult, conv17, conv17_leaky);
+    }
+    std::memcpy(stream_last[stream_done % 3], stream_b, 8);
+    ++stream_done;
+}
+
+// the newest window's last activation put back in nhwc order, then the rest of the model as usual
+static void stream_head(f32 *y) {
+    i8 *const t = arena;
+    for (u32 x = 0; x < 3; ++x) {
+        const i8 *col = stream_last[(stream_done - 3 + x) % 3];
+        for (u32 h = 0; h < 2; ++h) std::memcpy(t + (h * 3 + x) * 4, col + h * 4, 4);
+    }
+    // onnx_tf_prefix_/LeakyRelu_15
+    transpose_q8(arena + 32, arena, { 1, 2, 3, 4 }, { 0, 3, 1, 2 });
+    // flatten/Reshape;onnx_tf_prefix_/Reshape_1
+    // reshape: same bytes, nothing to do
+    // PartitionedCall:01
+    fully_connected_q8(arena, arena + 32, fc20_weights, fc20_bias, 24, 16, -126, 0, -5, { 1347165089, -8 }, -128, 127);
+    // PartitionedCall:0
+    dequantize_q8(y, arena, 16, 0.031162980943918228f, -5);
+}
+
+u32 aot_stream_hop() {
+    return 16;
+}
+
+void aot_stream_reset() {
+    for (u32 &s : stream_seen) s = 0;
+    stream_done = 0;
+}
+
+Status aot_stream_push(const Tensor<f32, 2> &columns) {
+    StageScope stage(STAGE_INFERENCE);
+    if (columns.dim<0>() != 16) {
+        THROW(std::runtime_error, "input wrong shape");
+        return take_error();
+    }
+    i8 col[16];
+    for (u32 c = 0; c < columns.dim<1>(); ++c) {
+        for (u32 r = 0; r < 16; ++r) quantize_q8(col + r, &columns(r, c), 1, 0.007843137718737125f, -1);
+        stream_column(col);
+    }
+    return Status{ nullptr };
+}
+
+bool aot_stream_ready() {
+    return stream_done >= 3;
+}
+
+Status aot_stream_output(Tensor<f32, 1> &res) {
+    StageScope stage(STAGE_INFERENCE);
+    if (!aot_stream_ready()) {
+        THROW(std::runtime_error, "no complete window streamed yet");
+        return take_error();
+    }
+    if (res.dim<0>() != 16) {
+        THROW(std::runtime_error, "output wrong shape");
+        return take_error();
+    }
+    stream_head(res.row(0));
+    return Status{ nullptr };
+}
+
+// builds that link this in place of tf.cpp and tflm. the model is presented as taking int8 input, so the
+// encoder quantizes its features straight into the buffer and the quantize step never runs.
+#ifdef AOT_INFERENCE
+Tensor<f32, 1> inference(const Tensor<f32, 2> &x) {
+    return aot_inference(x);
+}
+Status inference_into(Tensor<f32, 1> &res, const Tensor<f32, 2> &x) {
+    return aot_inference_into(res, x);
+}
+u32 inference_output_size() {
+    return aot_output_size();
+}
+ArenaScratch inference_scratch() {
+    return aot_scratch();
+}
+Tensor<f32, 2> inference_input() {
+    return {};
+}
+QTensor<i8, 2> inference_input_q8() {
+    return aot_input_q8();
+}
+Tensor<f32, 1> inference_output() {
+    return aot_output();
+}
+Status inference_invoke() {
+    return aot_invoke_q8();
+}
+Status inference_load(const u8 *, u32) {
+    return Status{ "compiled models can't be replaced at run time" };
+}
+Status inference_load_file(const char *) {
+    return Status{ "compiled models can't be replaced at run time" };
+}
+Status inference_swap() {
+    return Status{ "compiled models can't be replaced at run time" };
+}
+u32 inference_generation() {
+    return 0;
+}
+void inference_profile(bool) {}
+void inference_profile_report(void (*emit)(const char *line)) {
+    emit("no per-op profile: the model was compiled ahead of time");
+}
+#endif
@@ -0,0 +1,258 @@
+#ifndef A3EM_AI_NPY_H
+#define A3EM_AI_NPY_H
+
+#include <cstdio>
+#include <cstring>
+
+#include "./tensor.h"
+#include "./half.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#define NPY_MMAP 1
+#endif
+
+constexpr u32 npy_max_dims = 8;
+
+template<typename T> struct npy_dtype;
+template<> struct npy_dtype<u8> { static constexpr const char *descr = "|u1"; };
+template<> struct npy_dtype<i8> { static constexpr const char *descr = "|i1"; };
+template<> struct npy_dtype<u16> { static constexpr const char *descr = "<u2"; };
+template<> struct npy_dtype<i16> { static constexpr const char *descr = "<i2"; };
+template<> struct npy_dtype<u32> { static constexpr const char *descr = "<u4"; };
+template<> struct npy_dtype<i32> { static constexpr const char *descr = "<i4"; };
+template<> struct npy_dtype<f16> { static constexpr const char *descr = "<f2"; };
+template<> struct npy_dtype<f32> { static constexpr const char *descr = "<f4"; };
+template<> struct npy_dtype<f64> { static constexpr const char *descr = "<f8"; };
+template<> struct npy_dtype<c32> { static constexpr const char *descr = "<c8"; };
+template<> struct npy_dtype<c64> { static constexpr const char *descr = "<c16"; };
+
+struct NpyHeader {
+    char descr[8];
+    bool fortran_order;
+    u32 ndim;
+    u32 shape[npy_max_dims];
+    u32 data_offset;
+};
+
+// parses the python dict literal numpy writes, e.g. {'descr': '<f4', 'fortran_order': False, 'shape': (2, 3), }
+inline bool parse_npy_header(const u8 *buf, u64 len, NpyHeader &res) {
+    if (len < 10 || std::memcmp(buf, "\x93NUMPY", 6) != 0) return false;
+
+    u32 header_len, start;
+    if (buf[6] == 1) {
+        header_len = buf[8] | (u32)buf[9] << 8;
+        start = 10;
+    } else if (buf[6] == 2 || buf[6] == 3) {
+        if (len < 12) return false;
+        header_len = buf[8] | (u32)buf[9] << 8 | (u32)buf[10] << 16 | (u32)buf[11] << 24;
+        start = 12;
+    } else return false;
+    if ((u64)start + header_len > len) return false;
+
+    const char *h = reinterpret_cast<const char*>(buf + start);
+    const char *end = h + header_len;
+    auto find = [&](const char *key) -> const char* {
+        const u32 n = std::strlen(key);
+        for (const char *p = h; p + n <= end; ++p) {
+            if (std::memcmp(p, key, n) == 0) {
+                p += n;
+                while (p < end && (*p == ' ' || *p == ':')) ++p;
+                return p;
+            }
+        }
+        return nullptr;
+    };
+
+    const char *p = find("'descr'");
+    if (!p || p >= end || *p != '\'') return false;
+    u32 n = 0;
+    for (++p; p < end && *p != '\''; ++p) {
+        if (n + 1 >= sizeof(res.descr)) return false;
+        res.descr[n++] = *p;
+    }
+    res.descr[n] = 0;
+
+    p = find("'fortran_order'");
+    if (!p) return false;
+    res.fortran_order = p + 4 <= end && std::memcmp(p, "True", 4) == 0;
+
+    p = find("'shape'");
+    if (!p || p >= end || *p != '(') return false;
+    res.ndim = 0;
+    for (++p; p < end && *p != ')'; ) {
+        if (*p >= '0' && *p <= '9') {
+            if (res.ndim >= npy_max_dims) return false;
+            u32 v = 0;
+            for (; p < end && *p >= '0' && *p <= '9'; ++p) v = v * 10 + (*p - '0');
+            res.shape[res.ndim++] = v;
+        } else ++p;
+    }
+
+    res.data_offset = start + header_len;
+    return true;
+}
+
+class NpyFile {
+private:
+
+    u8 *base;
+    u64 len;
+    bool mapped;
+    bool owned;
+    NpyHeader header;
+
+    NpyFile() : base{nullptr}, len{0}, mapped{false}, owned{false}, header{} {}
+
+    void release() {
+#ifdef NPY_MMAP
+        if (base && mapped) munmap(base, len);
+#endif
+        if (base && owned && !mapped) aligned_delete(base);
+        base = nullptr;
+        len = 0;
+    }
+
+public:
+
+    ~NpyFile() { release(); }
+
+    NpyFile(const NpyFile &other) = delete;
+    NpyFile &operator=(const NpyFile &other) = delete;
+
+    NpyFile(NpyFile &&other) : NpyFile() {
+        *this = static_cast<NpyFile&&>(other);
+    }
+    NpyFile &operator=(NpyFile &&other) {
+        if (this != &other) {
+            release();
+            base = other.base;
+            len = other.len;
+            mapped = other.mapped;
+            owned = other.owned;
+            header = other.header;
+            other.base = nullptr;
+            other.len = 0;
+        }
+        return *this;
+    }
+
+    // wraps an existing buffer (e.g. an array linked into flash); the buffer must outlive the views
+    static NpyFile from_buffer(u8 *buf, u64 buf_len) {
+        NpyFile res;
+        if (!parse_npy_header(buf, buf_len, res.header)) {
+            THROW(std::runtime_error, "invalid npy header");
+            return res;
+        }
+        res.base = buf;
+        res.len = buf_len;
+        return res;
+    }
+
+    // maps the file copy-on-write, so views may be modified in place without touching the file
+    static NpyFile open(const char *path) {
+        NpyFile res;
+#ifdef NPY_MMAP
+        int fd = ::open(path, O_RDONLY);
+        if (fd < 0) {
+            THROW(std::runtime_error, "failed to open npy file");
+            return res;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+            ::close(fd);
+            THROW(std::runtime_error, "failed to stat npy file");
+            return res;
+        }
+        void *p = mmap(nullptr, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (p == MAP_FAILED) {
+            THROW(std::runtime_error, "failed to map npy file");
+            return res;
+        }
+        res.base = static_cast<u8*>(p);
+        res.len = (u64)st.st_size;
+        res.mapped = true;
+#else
+        FILE *f = std::fopen(path, "rb");
+        if (!f) {
+            THROW(std::runtime_error, "failed to open npy file");
+            return res;
+        }
+        std::fseek(f, 0, SEEK_END);
+        const long size = std::ftell(f);
+        std::fseek(f, 0, SEEK_SET);
+        res.base = aligned_new<u8>(size > 0 ? (u32)size : 0, 64);
+        res.len = size > 0 ? (u64)size : 0;
+        res.owned = true;
+        if (std::fread(res.base, 1, res.len, f) != res.len) res.len = 0;
+        std::fclose(f);
+#endif
+        if (!parse_npy_header(res.base, res.len, res.header)) {
+            res.release();
+            THROW(std::runtime_error, "invalid npy header");
+        }
+        return res;
+    }
+
+    bool valid() const { return base != nullptr; }
+    const NpyHeader &info() const { return header; }
+
+    template<typename T, u32 D> Tensor<T, D> view() {
+        if (!base) {
+            THROW(std::runtime_error, "npy file not open");
+            return {};
+        }
+        if (std::strcmp(header.descr, npy_dtype<T>::descr) != 0) {
+            THROW(std::runtime_error, "npy dtype mismatch");
+            return {};
+        }
+        if (header.fortran_order) {
+            THROW(std::runtime_error, "fortran-order npy arrays are not supported");
+            return {};
+        }
+        if (header.ndim != D) {
+            THROW(std::runtime_error, "npy rank mismatch");
+            return {};
+        }
+
+        u64 count = 1;
+        for (u32 i = 0; i < D; ++i) count *= header.shape[i];
+        if (header.data_offset + count * sizeof(T) > len) {
+            THROW(std::runtime_error, "npy file truncated");
+            return {};
+        }
+        if (reinterpret_cast<uintptr_t>(base + header.data_offset) % alignof(T) != 0) {
+            THROW(std::runtime_error, "npy data misaligned");
+            return {};
+        }
+
+        u32 dims[D];
+        for (u32 i = 0; i < D; ++i) dims[i] = header.shape[i];
+        return Tensor<T, D>::from_dims(reinterpret_cast<T*>(base + header.data_offset), nullptr, dims);
+    }
+};
+
+template<typename T, u32 D> bool npy_save(const char *path, const Tensor<T, D> &x) {
+    char dict[256];
+    int n = std::snprintf(dict, sizeof(dict), "{'descr': '%s', 'fortran_order': False, 'shape': (", npy_dtype<T>::descr);
+    for (u32 i = 0; i < D; ++i) n += std::snprintf(dict + n, sizeof(dict) - n, D == 1 ? "%u,), }" : i + 1 < D ? "%u, " : "%u), }", (unsigned)x.shape()[i]);
+
+    // pad so the data starts on a 64 byte boundary, which keeps mapped views aligned
+    const u32 total = (10 + n + 1 + 63) / 64 * 64;
+    const u32 header_len = total - 10;
+    u8 prefix[10] = { 0x93, 'N', 'U', 'M', 'P', 'Y', 1, 0, (u8)(header_len & 0xff), (u8)(header_len >> 8) };
+
+    FILE *f = std::fopen(path, "wb");
+    if (!f) return false;
+    bool ok = std::fwrite(prefix, 1, sizeof(prefix), f) == sizeof(prefix) && std::fwrite(dict, 1, n, f) == (size_t)n;
+    for (u32 i = (u32)n; ok && i + 1 < header_len; ++i) ok = std::fputc(' ', f) != EOF;
+    ok = ok && std::fputc('\n', f) != EOF;
+    for (u32 r = 0; ok && r < x.rows(); ++r) ok = std::fwrite(x.row(r), sizeof(T), x.template dim<D - 1>(), f) == x.template dim<D - 1>();
+    return std::fclose(f) == 0 && ok;
+}
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef A3EM_AI_PLANNER_H
+#define A3EM_AI_PLANNER_H
+
+#include <algorithm>
+
+#include "./types.h"
+
+// a buffer that must stay intact from step first through step last (inclusive)
+struct BufferSpec {
+    u32 size;  // in bytes
+    u32 align; // power of two
+    u32 first;
+    u32 last;
+};
+
+constexpr u32 unplanned = 0xffffffff;
+
+inline bool lifetimes_overlap(const BufferSpec &a, const BufferSpec &b) {
+    return a.first <= b.last && b.first <= a.last;
+}
+
+// greedy first-fit in order of decreasing size, the same strategy as tflm's GreedyMemoryPlanner.
+// writes one offset per buffer and returns the size of the region needed to hold all of them.
+inline u32 plan_buffers(const BufferSpec *specs, u32 count, u32 *offsets) {
+    for (u32 i = 0; i < count; ++i) offsets[i] = unplanned;
+
+    u32 total = 0;
+    for (u32 placed = 0; placed < count; ++placed) {
+        u32 next = unplanned;
+        for (u32 i = 0; i < count; ++i) {
+            if (offsets[i] == unplanned && (next == unplanned || specs[i].size > specs[next].size)) next = i;
+        }
+        const BufferSpec &s = specs[next];
+        const u32 align = s.align ? s.align : 1;
+
+        // the best spot is either the start of the region or directly after some live buffer
+        u32 best = unplanned;
+        for (u32 c = 0; c <= count; ++c) {
+            if (c < count && (offsets[c] == unplanned || !lifetimes_overlap(specs[c], s))) continue;
+            const u32 start = c == count ? 0 : offsets[c] + specs[c].size;
+            const u32 candidate = (start + align - 1) / align * align;
+            if (candidate >= best) continue;
+
+            bool fits = true;
+            for (u32 j = 0; j < count && fits; ++j) {
+                if (offsets[j] == unplanned || !lifetimes_overlap(specs[j], s)) continue;
+                fits = candidate + s.size <= offsets[j] || offsets[j] + specs[j].size <= candidate;
+            }
+            if (fits) best = candidate;
+        }
+
+        offsets[next] = best;
+        total = std::max(total, best + s.size);
+    }
+    return total;
+}
+
+// peak of the summed sizes of simultaneously live buffers, i.e. the lower bound for any plan
+inline u32 max_live_bytes(const BufferSpec *specs, u32 count) {
+    u32 res = 0;
+    for (u32 i = 0; i < count; ++i) {
+        u32 live = 0;
+        for (u32 j = 0; j < count; ++j) {
+            if (specs[j].first <= specs[i].first && specs[i].first <= specs[j].last) live += specs[j].size;
+        }
+        res = std::max(res, live);
+    }
+    return res;
+}
+
+#endif
@@ -0,0 +1,296 @@
+#include <cstdlib>
+#include <cstdio>
+#include <new>
+#include <initializer_list>
+
+#include "./pool.h"
+
+#if defined(__ARM_ARCH_7EM__)
+#define POOL_SECTION(name) __attribute__((section(name)))
+#else
+#define POOL_SECTION(name)
+#endif
+
+constexpr u32 pool_align = alignof(std::max_align_t);
+constexpr u32 pool_classes = 1 + 27 * 4;
+constexpr u16 pool_magic = 0xa3e4;
+
+struct alignas(pool_align) Header {
+    u32 size;
+    u8 region;
+    u8 cls;
+    u16 magic;
+};
+static_assert(sizeof(Header) == pool_align, "pool header must keep blocks aligned");
+
+struct FreeBlock {
+    FreeBlock *next;
+};
+
+struct RegionHeap {
+    u8 *base;
+    u32 capacity;
+    u32 used;
+    FreeBlock *free[pool_classes];
+};
+
+alignas(pool_align) static u8 tcm_heap[POOL_TCM_SIZE > 0 ? POOL_TCM_SIZE : 1];
+alignas(pool_align) static u8 shared_heap[POOL_SHARED_SIZE > 0 ? POOL_SHARED_SIZE : 1] POOL_SECTION(".shared");
+alignas(pool_align) static u8 extended_heap[POOL_EXTENDED_SIZE > 0 ? POOL_EXTENDED_SIZE : 1] POOL_SECTION(".extended");
+
+// constant initialized, so allocations made by other static constructors are safe
+static RegionHeap heaps[REGION_SYSTEM] = {
+    { tcm_heap, POOL_TCM_SIZE, 0, {} },
+    { shared_heap, POOL_SHARED_SIZE, 0, {} },
+    { extended_heap, POOL_EXTENDED_SIZE, 0, {} },
+};
+static PoolStats stats[REGION_COUNT + 1];
+static Region hint = REGION_TCM;
+static bool sealed = false;
+
+struct TraceRecord {
+    const void *p;
+    u32 born;
+    Stage stage;
+};
+static bool tracing = false;
+static Stage stage = STAGE_NONE;
+static u32 trace_clock = 0, trace_live = 0, trace_peak = 0;
+static StageTrace traces[STAGE_COUNT];
+static TraceRecord records[POOL_TRACE_RECORDS];
+
+// 16 bytes, then 4 classes per power of two: (2^p, 2^(p+1)] is split in steps of 2^(p-2)
+static u32 class_of(u32 size) {
+    if (size <= 16) return 0;
+    const u32 p = 31 - __builtin_clz(size - 1);
+    const u32 step = 1u << (p - 2);
+    const u32 k = (size - (1u << p) + step - 1) / step;
+    return 1 + (p - 4) * 4 + (k - 1);
+}
+static u32 class_size(u32 c) {
+    if (c == 0) return 16;
+    const u32 p = (c - 1) / 4 + 4, k = (c - 1) % 4 + 1;
+    return (1u << p) + k * (1u << (p - 2));
+}
+
+static Header *take(RegionHeap &heap, u32 c) {
+    if (FreeBlock *b = heap.free[c]) {
+        heap.free[c] = b->next;
+        return reinterpret_cast<Header*>(b) - 1;
+    }
+    const u32 need = (sizeof(Header) + class_size(c) + pool_align - 1) / pool_align * pool_align;
+    if (need > heap.capacity - heap.used) return nullptr;
+    Header *h = reinterpret_cast<Header*>(heap.base + heap.used);
+    heap.used += need;
+    return h;
+}
+
+static void count_alloc(Region r, u32 size) {
+    for (PoolStats *s : { &stats[r], &stats[REGION_ALL] }) {
+        s->live_bytes += size;
+        if (s->live_bytes > s->peak_bytes) s->peak_bytes = s->live_bytes;
+        ++s->allocs;
+    }
+}
+
+static void trace_alloc(const void *p, u32 size) {
+    StageTrace &t = traces[stage];
+    ++trace_clock;
+    ++t.allocs;
+    t.bytes += size;
+    if (stats[REGION_ALL].live_bytes > t.peak_bytes) t.peak_bytes = stats[REGION_ALL].live_bytes;
+    if (stats[REGION_ALL].live_bytes > trace_peak) trace_peak = stats[REGION_ALL].live_bytes;
+    if (trace_live == POOL_TRACE_RECORDS) {
+        ++t.untracked;
+        return;
+    }
+    records[trace_live++] = { p, trace_clock, stage };
+}
+static void trace_free(const void *p) {
+    ++trace_clock;
+    for (u32 i = 0; i < trace_live; ++i) {
+        if (records[i].p != p) continue;
+        StageTrace &t = traces[records[i].stage];
+        const u32 lifetime = trace_clock - records[i].born;
+        ++t.frees;
+        t.sum_lifetime += lifetime;
+        if (lifetime > t.max_lifetime) t.max_lifetime = lifetime;
+        records[i] = records[--trace_live];
+        return;
+    }
+}
+
+void *pool_alloc(std::size_t size, Region r) {
+    if (size == 0) size = 1;
+    if (r >= REGION_COUNT) r = REGION_TCM;
+    if (sealed) {
+        ++stats[r].sealed_allocs;
+        ++stats[REGION_ALL].sealed_allocs;
+#ifdef ZERO_HEAP
+        return nullptr;
+#endif
+    }
+
+    if (r != REGION_SYSTEM && size <= 0x80000000u) {
+        const u32 c = class_of((u32)size);
+        const Region order[] = { r, REGION_TCM, REGION_SHARED, REGION_EXTENDED };
+        for (u32 i = 0; i < sizeof(order) / sizeof(*order); ++i) {
+            const Region o = order[i];
+            if (o == REGION_SYSTEM || (i > 0 && o == r)) continue;
+            Header *h = take(heaps[o], c);
+            if (!h) continue;
+
+            h->size = (u32)size;
+            h->region = o;
+            h->cls = (u8)c;
+            h->magic = pool_magic;
+            stats[o].reserved_bytes = heaps[o].used;
+            stats[REGION_ALL].reserved_bytes = heaps[REGION_TCM].used + heaps[REGION_SHARED].used + heaps[REGION_EXTENDED].used;
+            if (o != r) ++stats[r].fallbacks;
+            count_alloc(o, (u32)size);
+            if (tracing) trace_alloc(h + 1, (u32)size);
+            return h + 1;
+        }
+    }
+
+    Header *h = static_cast<Header*>(std::malloc(sizeof(Header) + size));
+    if (!h) return nullptr;
+    h->size = (u32)size;
+    h->region = REGION_SYSTEM;
+    h->cls = 0;
+    h->magic = pool_magic;
+    if (r != REGION_SYSTEM) ++stats[r].fallbacks;
+    count_alloc(REGION_SYSTEM, (u32)size);
+    if (tracing) trace_alloc(h + 1, (u32)size);
+    return h + 1;
+}
+
+void pool_free(void *p) {
+    if (!p) return;
+    Header *h = static_cast<Header*>(p) - 1;
+    if (h->magic != pool_magic) return;
+    if (tracing) trace_free(p);
+
+    const Region r = (Region)h->region;
+    for (PoolStats *s : { &stats[r], &stats[REGION_ALL] }) {
+        s->live_bytes -= h->size;
+        ++s->frees;
+    }
+
+    if (r == REGION_SYSTEM) {
+        h->magic = 0;
+        std::free(h);
+        return;
+    }
+    FreeBlock *b = reinterpret_cast<FreeBlock*>(p);
+    b->next = heaps[r].free[h->cls];
+    heaps[r].free[h->cls] = b;
+}
+
+Region pool_region_of(const void *p) {
+    if (!p) return REGION_COUNT;
+    return (Region)(static_cast<const Header*>(p) - 1)->region;
+}
+
+u32 pool_class_size(std::size_t size) {
+    return class_size(class_of(size ? (u32)size : 1));
+}
+
+const PoolStats &pool_stats(Region r) {
+    return stats[r <= REGION_ALL ? r : REGION_ALL];
+}
+
+void pool_reset_stats() {
+    for (u32 i = 0; i <= REGION_COUNT; ++i) {
+        const u32 live = stats[i].live_bytes, reserved = stats[i].reserved_bytes;
+        stats[i] = {};
+        stats[i].live_bytes = live;
+        stats[i].peak_bytes = live;
+        stats[i].reserved_bytes = reserved;
+    }
+}
+
+void pool_seal(bool s) {
+    sealed = s;
+}
+bool pool_sealed() {
+    return sealed;
+}
+
+void pool_trace(bool on) {
+    tracing = on;
+    if (!on) return;
+    trace_clock = 0;
+    trace_live = 0;
+    for (StageTrace &t : traces) t = {};
+    trace_peak = traces[stage].peak_bytes = stats[REGION_ALL].live_bytes;
+}
+bool pool_tracing() {
+    return tracing;
+}
+const StageTrace &pool_trace_stats(Stage s) {
+    return traces[s < STAGE_COUNT ? s : STAGE_NONE];
+}
+const char *pool_stage_name(Stage s) {
+    static const char *const names[STAGE_COUNT] = { "other", "lowpass", "spectrogram", "mel", "dct", "normalize", "inference" };
+    return names[s < STAGE_COUNT ? s : STAGE_NONE];
+}
+
+void pool_trace_report(void (*emit)(const char *line)) {
+    char line[128];
+    std::snprintf(line, sizeof(line), "%-12s %8s %8s %10s %10s %10s %10s", "stage", "allocs", "frees", "bytes", "peak", "mean life", "max life");
+    emit(line);
+    for (u32 i = 0; i < STAGE_COUNT; ++i) {
+        const StageTrace &t = traces[i];
+        if (t.allocs == 0 && t.peak_bytes == 0) continue;
+        std::snprintf(line, sizeof(line), "%-12s %8lu %8lu %10lu %10lu %10lu %10lu%s", pool_stage_name((Stage)i), (unsigned long)t.allocs,
+            (unsigned long)t.frees, (unsigned long)t.bytes, (unsigned long)t.peak_bytes, (unsigned long)(t.frees ? t.sum_lifetime / t.frees : 0),
+            (unsigned long)t.max_lifetime, t.untracked ? " (some untracked)" : "");
+        emit(line);
+    }
+    std::snprintf(line, sizeof(line), "%-12s %8s %8s %10s %10lu", "overall", "", "", "", (unsigned long)trace_peak);
+    emit(line);
+}
+
+Stage pool_stage() {
+    return stage;
+}
+void pool_set_stage(Stage s) {
+    stage = s < STAGE_COUNT ? s : STAGE_NONE;
+    if (tracing && stats[REGION_ALL].live_bytes > traces[stage].peak_bytes) traces[stage].peak_bytes = stats[REGION_ALL].live_bytes;
+}
+
+Region pool_hint() {
+    return hint;
+}
+void pool_set_hint(Region r) {
+    hint = r;
+}
+
+void *operator new(std::size_t s) noexcept(noexcept(operator new(1))) {
+    return pool_alloc(s, hint);
+}
+void *operator new[](std::size_t s) noexcept(noexcept(operator new[](1))) {
+    return pool_alloc(s, hint);
+}
+// the nothrow forms may return null, so callers that check for it (aligned_new) keep the check
+void *operator new(std::size_t s, const std::nothrow_t&) noexcept {
+    return pool_alloc(s, hint);
+}
+void *operator new[](std::size_t s, const std::nothrow_t&) noexcept {
+    return pool_alloc(s, hint);
+}
+
+void operator delete(void *p) noexcept {
+    pool_free(p);
+}
+void operator delete(void *p, std::size_t) noexcept {
+    pool_free(p);
+}
+
+void operator delete[](void *p) noexcept {
+    pool_free(p);
+}
+void operator delete[](void *p, std::size_t) noexcept {
+    pool_free(p);
+}
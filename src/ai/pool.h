@@ -0,0 +1,108 @@
+#ifndef A3EM_AI_POOL_H
+#define A3EM_AI_POOL_H
+
+#include <cstddef>
+
+#include "./types.h"
+
+// memory regions from a3em.ld that the pools carve from; REGION_SYSTEM is the newlib heap (in TCM) used as the last resort
+enum Region : u8 { REGION_TCM, REGION_SHARED, REGION_EXTENDED, REGION_SYSTEM, REGION_COUNT, REGION_ALL = REGION_COUNT };
+
+#ifndef POOL_TCM_SIZE
+#define POOL_TCM_SIZE (64 * 1024)
+#endif
+#ifndef POOL_SHARED_SIZE
+#define POOL_SHARED_SIZE (512 * 1024)
+#endif
+#ifndef POOL_EXTENDED_SIZE
+#define POOL_EXTENDED_SIZE (256 * 1024)
+#endif
+
+struct PoolStats {
+    u32 live_bytes;     // requested bytes currently allocated
+    u32 peak_bytes;     // max of live_bytes since the last reset
+    u32 reserved_bytes; // bytes carved from the region so far, including headers and size class rounding
+    u32 allocs;
+    u32 frees;
+    u32 fallbacks;      // requests hinted at this region that had to be served elsewhere
+    u32 sealed_allocs;  // requests made while the pools were sealed
+};
+
+// size-class pools: every request is rounded up to one of four classes per power of two and freed blocks are
+// kept on a per-class list for reuse, so steady-state allocation is O(1) and never fragments. not thread safe.
+void *pool_alloc(std::size_t size, Region hint);
+void pool_free(void *p);
+Region pool_region_of(const void *p);
+u32 pool_class_size(std::size_t size);
+
+// pass REGION_ALL for the totals over every region
+const PoolStats &pool_stats(Region r);
+// clears the counters and restarts peak tracking from the current live bytes
+void pool_reset_stats();
+
+// marks the end of initialization: every later request is counted in sealed_allocs, and in ZERO_HEAP builds it fails
+void pool_seal(bool sealed);
+bool pool_sealed();
+
+Region pool_hint();
+void pool_set_hint(Region r);
+
+// pipeline stages that allocations are tagged with while tracing
+enum Stage : u8 { STAGE_NONE, STAGE_LOWPASS, STAGE_SPECTROGRAM, STAGE_MEL, STAGE_DCT, STAGE_NORMALIZE, STAGE_INFERENCE, STAGE_COUNT };
+
+#ifndef POOL_TRACE_RECORDS
+#define POOL_TRACE_RECORDS 256
+#endif
+
+// lifetimes are counted in allocator events (allocs + frees) so host and target reports line up
+struct StageTrace {
+    u32 allocs;
+    u32 frees;
+    u32 bytes;         // total requested
+    u32 peak_bytes;    // max live bytes over all stages while this one was active
+    u32 max_lifetime;
+    u32 sum_lifetime;  // over frees, for the mean
+    u32 untracked;     // allocations made while the record table was full, so their lifetimes are unknown
+};
+
+// tracing is off by default and costs one branch per call; turning it on clears the previous trace
+void pool_trace(bool on);
+bool pool_tracing();
+const StageTrace &pool_trace_stats(Stage s);
+const char *pool_stage_name(Stage s);
+// emits the trace as lines of text, one per stage plus a header, e.g. to the debug log or a file
+void pool_trace_report(void (*emit)(const char *line));
+
+Stage pool_stage();
+void pool_set_stage(Stage s);
+
+class StageScope {
+private:
+
+    Stage prev;
+
+public:
+
+    explicit StageScope(Stage s) : prev{pool_stage()} { pool_set_stage(s); }
+    ~StageScope() { pool_set_stage(prev); }
+
+    StageScope(const StageScope &other) = delete;
+    StageScope &operator=(const StageScope &other) = delete;
+};
+
+// routes every allocation made while it is alive (operator new, Tensor::alloc, ...) to the given region
+class RegionScope {
+private:
+
+    Region prev;
+
+public:
+
+    explicit RegionScope(Region r) : prev{pool_hint()} { pool_set_hint(r); }
+    ~RegionScope() { pool_set_hint(prev); }
+
+    RegionScope(const RegionScope &other) = delete;
+    RegionScope &operator=(const RegionScope &other) = delete;
+};
+
+#endif
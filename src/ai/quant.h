@@ -0,0 +1,210 @@
+#ifndef A3EM_AI_QUANT_H
+#define A3EM_AI_QUANT_H
+
+#include <limits>
+#include <cmath>
+
+#include "./tensor.h"
+
+// real = scale * (q - zero_point)
+struct QParams {
+    f32 scale;
+    i32 zero_point;
+};
+
+// real multiplier ~= multiplier * 2^(shift - 31), with multiplier in [2^30, 2^31)
+struct QMultiplier {
+    i32 multiplier;
+    i32 shift;
+};
+
+template<typename Q> struct is_quantized { static constexpr bool value = std::is_same<Q, i8>::value || std::is_same<Q, i16>::value; };
+
+template<typename Q, u32 D>
+struct QTensor {
+    static_assert(is_quantized<Q>::value, "QTensor only supports i8 and i16 storage");
+
+    Tensor<Q, D> data;
+    QParams params;
+
+    template<u32 i, std::enable_if_t<(i < D), int> = 0>
+    u32 dim() const {
+        return data.template dim<i>();
+    }
+
+    template<typename ...Args, std::enable_if_t<sizeof...(Args) == D, int> = 0>
+    f32 get(Args ...pos) const {
+        return params.scale * (f32)((i32)data(pos...) - params.zero_point);
+    }
+
+    template<typename ...Args, std::enable_if_t<sizeof...(Args) == D, int> = 0>
+    static QTensor alloc(QParams params, Args ...dims) {
+        return { Tensor<Q, D>::alloc(dims...), params };
+    }
+};
+
+template<typename Q> i32 saturate(i32 v) {
+    return std::min<i32>(std::max<i32>(v, std::numeric_limits<Q>::min()), std::numeric_limits<Q>::max());
+}
+
+// asymmetric params covering [min, max] with zero exactly representable
+template<typename Q> QParams choose_qparams(f32 min, f32 max) {
+    min = std::min(min, 0.0f);
+    max = std::max(max, 0.0f);
+    const f32 qmin = std::numeric_limits<Q>::min(), qmax = std::numeric_limits<Q>::max();
+    if (max == min) return { 1, 0 };
+
+    const f32 scale = (max - min) / (qmax - qmin);
+    const i32 zero_point = saturate<Q>((i32)std::round(qmin - min / scale));
+    return { scale, zero_point };
+}
+
+template<typename Q> QParams choose_symmetric_qparams(f32 abs_max) {
+    if (abs_max == 0) return { 1, 0 };
+    return { abs_max / (f32)std::numeric_limits<Q>::max(), 0 };
+}
+
+template<typename Q> Q quantize_value(f32 v, QParams p) {
+    return (Q)saturate<Q>((i32)std::round(v / p.scale) + p.zero_point);
+}
+
+inline QMultiplier quantize_multiplier(f64 real) {
+    if (real == 0) return { 0, 0 };
+    int shift;
+    const f64 m = std::frexp(real, &shift);
+    i64 q = (i64)std::round(m * (f64)(1ll << 31));
+    if (q == (1ll << 31)) {
+        q /= 2;
+        ++shift;
+    }
+    if (shift < -31) return { 0, 0 };
+    return { (i32)q, shift };
+}
+
+inline i32 multiply_by_quantized_multiplier(i32 x, QMultiplier m) {
+    const i32 total_shift = 31 - m.shift;
+    const i64 round = total_shift > 0 ? (i64)1 << (total_shift - 1) : 0;
+    const i64 prod = (i64)x * m.multiplier;
+    return total_shift > 0 ? (i32)((prod + round) >> total_shift) : (i32)(prod << -total_shift);
+}
+
+template<typename Q, u32 D> void quantize_into(QTensor<Q, D> &res, const Tensor<f32, D> &x) {
+    if (res.data.size() != x.size() || res.data.rows() != x.rows()) {
+        THROW(std::runtime_error, "quantize incompatible sizes");
+        return;
+    }
+    const f32 inv_scale = 1 / res.params.scale;
+    const i32 zp = res.params.zero_point;
+    for (u32 r = 0; r < x.rows(); ++r) {
+        const f32 *src = x.row(r);
+        Q *dst = res.data.row(r);
+        for (u32 i = 0; i < x.template dim<D - 1>(); ++i) dst[i] = (Q)saturate<Q>((i32)std::round(src[i] * inv_scale) + zp);
+    }
+}
+template<typename Q, u32 D> QTensor<Q, D> quantize(const Tensor<f32, D> &x, QParams params) {
+    QTensor<Q, D> res { Tensor<Q, D>::alloc_dims(default_alloc_policy, x.shape()), params };
+    quantize_into(res, x);
+    return res;
+}
+template<typename Q, u32 D> QTensor<Q, D> quantize(Tensor<f32, D> &x) {
+    return quantize<Q>(x, choose_qparams<Q>(x.min(), x.max()));
+}
+
+template<typename Q, u32 D> void dequantize_into(Tensor<f32, D> &res, const QTensor<Q, D> &x) {
+    if (res.size() != x.data.size() || res.rows() != x.data.rows()) {
+        THROW(std::runtime_error, "dequantize incompatible sizes");
+        return;
+    }
+    const f32 scale = x.params.scale;
+    const i32 zp = x.params.zero_point;
+    for (u32 r = 0; r < res.rows(); ++r) {
+        const Q *src = x.data.row(r);
+        f32 *dst = res.row(r);
+        for (u32 i = 0; i < res.template dim<D - 1>(); ++i) dst[i] = scale * (f32)((i32)src[i] - zp);
+    }
+}
+template<typename Q, u32 D> Tensor<f32, D> dequantize(const QTensor<Q, D> &x) {
+    auto res = Tensor<f32, D>::alloc_dims(default_alloc_policy, x.data.shape());
+    dequantize_into(res, x);
+    return res;
+}
+
+template<typename QOut, typename QIn, u32 D> void requantize_into(QTensor<QOut, D> &res, const QTensor<QIn, D> &x) {
+    if (res.data.size() != x.data.size() || res.data.rows() != x.data.rows()) {
+        THROW(std::runtime_error, "requantize incompatible sizes");
+        return;
+    }
+    const QMultiplier m = quantize_multiplier((f64)x.params.scale / res.params.scale);
+    const i32 zi = x.params.zero_point, zo = res.params.zero_point;
+    for (u32 r = 0; r < x.data.rows(); ++r) {
+        const QIn *src = x.data.row(r);
+        QOut *dst = res.data.row(r);
+        for (u32 i = 0; i < x.data.template dim<D - 1>(); ++i) dst[i] = (QOut)saturate<QOut>(multiply_by_quantized_multiplier((i32)src[i] - zi, m) + zo);
+    }
+}
+template<typename QOut, typename QIn, u32 D> QTensor<QOut, D> requantize(const QTensor<QIn, D> &x, QParams params) {
+    QTensor<QOut, D> res { Tensor<QOut, D>::alloc_dims(default_alloc_policy, x.data.shape()), params };
+    requantize_into(res, x);
+    return res;
+}
+
+// sum_i (a_i - za) * (b_i - zb) with a 32-bit accumulator
+template<typename Q> i32 qdot(const Q *a, i32 za, const Q *b, i32 zb, u32 n) {
+    i32 s0 = 0, s1 = 0;
+    u32 i = 0;
+    for (; i + 2 <= n; i += 2) {
+        s0 += ((i32)a[i] - za) * ((i32)b[i] - zb);
+        s1 += ((i32)a[i + 1] - za) * ((i32)b[i + 1] - zb);
+    }
+    if (i < n) s0 += ((i32)a[i] - za) * ((i32)b[i] - zb);
+    return s0 + s1;
+}
+
+// sum_i (a_i - b_i)^2 for two vectors sharing the same params (embeddings vs centroids)
+template<typename Q> i32 ql2_norm_sqr(const Q *a, const Q *b, u32 n) {
+    i32 s = 0;
+    for (u32 i = 0; i < n; ++i) {
+        const i32 d = (i32)a[i] - (i32)b[i];
+        s += d * d;
+    }
+    return s;
+}
+
+template<typename Q> void qmatmul_into(QTensor<Q, 2> &res, const QTensor<Q, 2> &a, const QTensor<Q, 2> &b, i32 *acc = nullptr) {
+    if (a.template dim<1>() != b.template dim<0>() || res.template dim<0>() != a.template dim<0>() || res.template dim<1>() != b.template dim<1>()) {
+        THROW(std::runtime_error, "qmatmul incompatible sizes");
+        return;
+    }
+
+    const u32 m = a.template dim<0>(), n = b.template dim<1>(), k = a.template dim<1>();
+    if (m == 0 || n == 0) return;
+
+    const QMultiplier mult = quantize_multiplier((f64)a.params.scale * b.params.scale / res.params.scale);
+    const i32 za = a.params.zero_point, zb = b.params.zero_point, zc = res.params.zero_point;
+
+    i32 *row_acc = acc ? acc : aligned_new<i32>(n);
+    for (u32 i = 0; i < m; ++i) {
+        for (u32 j = 0; j < n; ++j) row_acc[j] = 0;
+        const Q *ai = a.data.row(i);
+        for (u32 p = 0; p < k; ++p) {
+            const i32 v = (i32)ai[p] - za;
+            const Q *bp = b.data.row(p);
+            for (u32 j = 0; j < n; ++j) row_acc[j] += v * ((i32)bp[j] - zb);
+        }
+        Q *ci = res.data.row(i);
+        for (u32 j = 0; j < n; ++j) ci[j] = (Q)saturate<Q>(multiply_by_quantized_multiplier(row_acc[j], mult) + zc);
+    }
+    if (!acc) aligned_delete(row_acc);
+}
+template<typename Q> QTensor<Q, 2> qmatmul(const QTensor<Q, 2> &a, const QTensor<Q, 2> &b, QParams params) {
+    if (a.template dim<1>() != b.template dim<0>()) {
+        THROW(std::runtime_error, "qmatmul incompatible sizes");
+        return {};
+    }
+
+    auto res = QTensor<Q, 2>::alloc(params, a.template dim<0>(), b.template dim<1>());
+    qmatmul_into(res, a, b);
+    return res;
+}
+
+#endif
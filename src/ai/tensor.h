@@ -3,32 +3,212 @@
 
 #include <type_traits>
 #include <stdexcept>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <new>
 
 #include "./types.h"
 
+#ifndef TENSOR_ALIGN
+#if defined(__ARM_ARCH_7EM__)
+#define TENSOR_ALIGN 8
+#else
+#define TENSOR_ALIGN 32
+#endif
+#endif
+
+#if defined(__GNUC__)
+#define ASSUME_ALIGNED(p, a) static_cast<decltype(p)>(__builtin_assume_aligned((p), (a)))
+#else
+#define ASSUME_ALIGNED(p, a) (p)
+#endif
+
+struct AllocPolicy {
+    u32 align; // alignment of the first element (power of two)
+    u32 pad;   // row length in bytes is rounded up to a multiple of this (0 for packed rows)
+};
+
+constexpr AllocPolicy default_alloc_policy = { TENSOR_ALIGN, TENSOR_ALIGN };
+constexpr AllocPolicy packed_alloc_policy = { TENSOR_ALIGN, 0 };
+
+// the raw block pointer is stashed immediately before the aligned storage so the deleter can stay a plain function pointer
+template<typename T> T *aligned_new(u32 count, u32 align = TENSOR_ALIGN) {
+    static_assert(std::is_trivially_destructible<T>::value, "aligned_new only supports trivial element types");
+    if (align < alignof(T)) align = alignof(T);
+    if (align < alignof(void*)) align = alignof(void*);
+    if (align & (align - 1)) {
+        THROW(std::runtime_error, "alignment must be a power of two");
+        return nullptr;
+    }
+
+    // the nothrow form, since the compiler may drop a null check on plain operator new, and the pool's returns null
+    // when it is sealed in ZERO_HEAP builds
+    u8 *raw = static_cast<u8*>(::operator new(count * sizeof(T) + align + sizeof(void*), std::nothrow));
+    if (!raw) return nullptr;
+    uintptr_t p = (reinterpret_cast<uintptr_t>(raw) + sizeof(void*) + align - 1) & ~(uintptr_t)(align - 1);
+    reinterpret_cast<void**>(p)[-1] = raw;
+    return reinterpret_cast<T*>(p);
+}
+template<typename T> void aligned_delete(T *p) {
+    if (p) ::operator delete(reinterpret_cast<void**>(p)[-1]);
+}
+
+// reductions keep several independent accumulators so consecutive steps don't wait on each other: gcc vector
+// registers on the host, four unrolled scalars on the target. f combines two partials and g maps each element;
+// both are called with vectors too, so they must be written with plain operators.
+#if defined(__GNUC__) && !defined(__ARM_ARCH_7EM__) && !defined(REDUCE_VECTOR_BYTES)
+#if defined(__AVX__)
+#define REDUCE_VECTOR_BYTES 32
+#else
+#define REDUCE_VECTOR_BYTES 16
+#endif
+#endif
+#ifndef REDUCE_BLOCK
+#define REDUCE_BLOCK 256
+#endif
+
+template<typename T, typename F, typename G> T reduce_unrolled(const T *p, u32 n, T init, F f, G g) {
+    T a0 = init, a1 = init, a2 = init, a3 = init;
+    u32 i = 0;
+    for (; i + 4 <= n; i += 4) {
+        a0 = f(a0, g(p[i]));
+        a1 = f(a1, g(p[i + 1]));
+        a2 = f(a2, g(p[i + 2]));
+        a3 = f(a3, g(p[i + 3]));
+    }
+    for (; i < n; ++i) a0 = f(a0, g(p[i]));
+    return f(f(a0, a1), f(a2, a3));
+}
+
+template<typename T, typename F, typename G, std::enable_if_t<!std::is_arithmetic<T>::value, int> = 0>
+T reduce_block(const T *p, u32 n, T init, F f, G g) {
+    return reduce_unrolled(p, n, init, f, g);
+}
+template<typename T, typename F, typename G, std::enable_if_t<std::is_arithmetic<T>::value, int> = 0>
+T reduce_block(const T *p, u32 n, T init, F f, G g) {
+#ifdef REDUCE_VECTOR_BYTES
+    typedef T V __attribute__((vector_size(REDUCE_VECTOR_BYTES)));
+    constexpr u32 w = REDUCE_VECTOR_BYTES / sizeof(T);
+    if (n >= 2 * w) {
+        V a, b, x, y;
+        for (u32 j = 0; j < w; ++j) a[j] = b[j] = init;
+        u32 i = 0;
+        for (; i + 2 * w <= n; i += 2 * w) {
+            std::memcpy(&x, p + i, sizeof(V));
+            std::memcpy(&y, p + i + w, sizeof(V));
+            a = f(a, g(x));
+            b = f(b, g(y));
+        }
+        a = f(a, b);
+
+        T lanes[w];
+        std::memcpy(lanes, &a, sizeof(V));
+        return f(reduce_unrolled(lanes, w, init, f, [](T v) { return v; }), reduce_unrolled(p + i, n - i, init, f, g));
+    }
+#endif
+    return reduce_unrolled(p, n, init, f, g);
+}
+
+// pairwise over blocks of REDUCE_BLOCK, so the rounding error grows with log(n) rather than n
+template<typename T, typename G> T reduce_sum(const T *p, u32 n, G g) {
+    if (n <= REDUCE_BLOCK) return reduce_block(p, n, T{}, [](auto a, auto b) { return a + b; }, g);
+    const u32 half = (n / 2 + REDUCE_BLOCK - 1) / REDUCE_BLOCK * REDUCE_BLOCK;
+    return reduce_sum(p, half, g) + reduce_sum(p + half, n - half, g);
+}
+template<typename T> T reduce_sum(const T *p, u32 n) {
+    return reduce_sum(p, n, [](auto v) { return v; });
+}
+template<typename T, typename G> T reduce_max(const T *p, u32 n, T init, G g) {
+    return reduce_block(p, n, init, [](auto a, auto b) { return b > a ? b : a; }, g);
+}
+template<typename T> T reduce_max(const T *p, u32 n, T init) {
+    return reduce_max(p, n, init, [](auto v) { return v; });
+}
+template<typename T> T reduce_min(const T *p, u32 n, T init) {
+    return reduce_block(p, n, init, [](auto a, auto b) { return b < a ? b : a; }, [](auto v) { return v; });
+}
+
 template<typename T, u32 D, std::enable_if_t<(D > 0), int> = 0>
 class Tensor {
 private:
 
     u32 dims[D];
+    u32 ld; // distance between consecutive rows (innermost dimension) in elements
     T *data;
     void (*deleter)(T*);
 
+    // hands out rows with their alignment asserted when the layout allows it so the loops vectorize
+    template<typename F> void each_row(F f) {
+        const u32 r = rows(), n = dims[D - 1];
+        if (aligned(TENSOR_ALIGN)) for (u32 i = 0; i < r; ++i) f(ASSUME_ALIGNED(data + i * ld, TENSOR_ALIGN), n);
+        else for (u32 i = 0; i < r; ++i) f(data + i * ld, n);
+    }
+    template<typename F> void each_row(F f) const {
+        const u32 r = rows(), n = dims[D - 1];
+        if (aligned(TENSOR_ALIGN)) for (u32 i = 0; i < r; ++i) f(ASSUME_ALIGNED(static_cast<const T*>(data + i * ld), TENSOR_ALIGN), n);
+        else for (u32 i = 0; i < r; ++i) f(static_cast<const T*>(data + i * ld), n);
+    }
+
 public:
 
-    Tensor() : dims{0}, data{nullptr}, deleter{nullptr} {};
+    Tensor() : dims{0}, ld{0}, data{nullptr}, deleter{nullptr} {};
     ~Tensor() {
         if (deleter && data) deleter(data);
         data = nullptr;
     }
 
     template<typename ...Args, std::enable_if_t<sizeof...(Args) == D, int> = 0>
-    Tensor(T *_data, void (*_deleter)(T*), Args ..._dims) : dims{static_cast<u32>(_dims)...}, data{_data}, deleter{_deleter} {}
+    Tensor(T *_data, void (*_deleter)(T*), Args ..._dims) : dims{static_cast<u32>(_dims)...}, ld{dims[D - 1]}, data{_data}, deleter{_deleter} {}
+
+    template<typename ...Args, std::enable_if_t<sizeof...(Args) == D, int> = 0>
+    static Tensor strided(T *_data, void (*_deleter)(T*), u32 _stride, Args ..._dims) {
+        Tensor res { _data, _deleter, _dims... };
+        if (_stride < res.dims[D - 1]) {
+            THROW(std::runtime_error, "row stride smaller than row length");
+            return res;
+        }
+        res.ld = _stride;
+        return res;
+    }
+
+    static Tensor from_dims(T *_data, void (*_deleter)(T*), const u32 (&_dims)[D]) {
+        Tensor res;
+        for (u32 i = 0; i < D; ++i) res.dims[i] = _dims[i];
+        res.ld = res.dims[D - 1];
+        res.data = _data;
+        res.deleter = _deleter;
+        return res;
+    }
+
+    // row stride (in elements) that alloc uses for rows of the given length
+    static u32 padded_stride(AllocPolicy policy, u32 cols) {
+        if (!policy.pad || policy.pad % sizeof(T) != 0) return cols;
+        const u32 step = policy.pad / sizeof(T);
+        return (cols + step - 1) / step * step;
+    }
+
+    static Tensor alloc_dims(AllocPolicy policy, const u32 (&_dims)[D]) {
+        Tensor res = from_dims(nullptr, nullptr, _dims);
+        if (D > 1) res.ld = padded_stride(policy, res.ld);
+        res.data = aligned_new<T>(res.rows() * res.ld, policy.align);
+        res.deleter = [](T *v) { aligned_delete(v); };
+        return res;
+    }
+    template<typename ...Args, std::enable_if_t<sizeof...(Args) == D, int> = 0>
+    static Tensor alloc(AllocPolicy policy, Args ..._dims) {
+        const u32 d[D] = {static_cast<u32>(_dims)...};
+        return alloc_dims(policy, d);
+    }
+    template<typename ...Args, std::enable_if_t<sizeof...(Args) == D, int> = 0>
+    static Tensor alloc(Args ..._dims) {
+        return alloc(default_alloc_policy, _dims...);
+    }
 
     Tensor(const Tensor &other) = delete;
     Tensor &operator=(const Tensor &other) = delete;
 
-    Tensor(Tensor &&other) : dims{0}, data{nullptr}, deleter{nullptr} {
+    Tensor(Tensor &&other) : dims{0}, ld{0}, data{nullptr}, deleter{nullptr} {
         *this = static_cast<Tensor&&>(other);
     }
     Tensor &operator=(Tensor &&other) {
@@ -40,6 +220,8 @@ public:
                 dims[i] = other.dims[i];
                 other.dims[i] = 0;
             }
+            ld = other.ld;
+            other.ld = 0;
 
             data = other.data;
             other.data = nullptr;
@@ -54,16 +236,18 @@ public:
         data = nullptr;
         deleter = nullptr;
         for (u32 i = 0; i < D; ++i) dims[i] = 0;
+        ld = 0;
     }
 
     Tensor into_owned() && {
         Tensor res { static_cast<Tensor&&>(*this) };
         if (!res.deleter && res.data) {
-            u32 s = res.size();
-            T *new_data = new T[s];
-            for (u32 i = 0; i < s; ++i) new_data[i] = res.data[i];
-            res.data = new_data;
-            res.deleter = [](auto *v) { delete[] v; };
+            Tensor copy = alloc_dims(default_alloc_policy, res.dims);
+            const u32 r = res.rows();
+            for (u32 i = 0; i < r; ++i) {
+                for (u32 j = 0; j < res.dims[D - 1]; ++j) copy.data[i * copy.ld + j] = res.data[i * res.ld + j];
+            }
+            res = static_cast<Tensor&&>(copy);
         }
         return res;
     }
@@ -73,12 +257,45 @@ public:
         return dims[i];
     }
 
+    const u32 (&shape() const)[D] {
+        return dims;
+    }
+
     u32 size() const {
         u32 res = 1;
         for (u32 i = 0; i < D; ++i) res *= dims[i];
         return res;
     }
 
+    u32 rows() const {
+        u32 res = 1;
+        for (u32 i = 0; i + 1 < D; ++i) res *= dims[i];
+        return res;
+    }
+
+    u32 stride() const {
+        return ld;
+    }
+
+    bool contiguous() const {
+        return ld == dims[D - 1];
+    }
+
+    bool aligned(u32 align) const {
+        return reinterpret_cast<uintptr_t>(data) % align == 0 && (rows() <= 1 || (ld * sizeof(T)) % align == 0);
+    }
+
+    T *row(u32 r) {
+        return const_cast<T*>(const_cast<const Tensor*>(this)->row(r));
+    }
+    const T *row(u32 r) const {
+        if (r >= rows()) {
+            THROW(std::runtime_error, "row out of bounds");
+            return data;
+        }
+        return data + r * ld;
+    }
+
     template<typename ...Args, std::enable_if_t<sizeof...(Args) == D, int> = 0>
     T &operator()(Args ...pos) {
         return const_cast<T&>(const_cast<const Tensor*>(this)->operator()(pos...));
@@ -90,43 +307,58 @@ public:
         u32 p = 0;
         u32 s = 1;
         for (u32 i = D; i-- > 0; ) {
-            if (pos[i] >= dims[i]) THROW(std::runtime_error("index out of bounds"));
+            if (pos[i] >= dims[i]) {
+                THROW(std::runtime_error, "index out of bounds");
+                static T sink;
+                return sink;
+            }
 
             p += pos[i] * s;
-            s *= dims[i];
+            s *= i == D - 1 ? ld : dims[i];
         }
         return data[p];
     }
 
+    Tensor &fill(T v) & {
+        each_row([&](T *p, u32 n) { for (u32 i = 0; i < n; ++i) p[i] = v; });
+        return *this;
+    }
+
     Tensor &maximum(T v) & {
-        for (u32 i = size(); i-- > 0; ) data[i] = std::max(data[i], v);
+        each_row([&](T *p, u32 n) { for (u32 i = 0; i < n; ++i) p[i] = std::max(p[i], v); });
         return *this;
     }
 
     Tensor &minimum(T v) & {
-        for (u32 i = size(); i-- > 0; ) data[i] = std::min(data[i], v);
+        each_row([&](T *p, u32 n) { for (u32 i = 0; i < n; ++i) p[i] = std::min(p[i], v); });
         return *this;
     }
 
     T max() {
-        if (size() <= 0) THROW(std::runtime_error("attempt to get max of empty tensor"));
+        if (size() <= 0) {
+            THROW(std::runtime_error, "attempt to get max of empty tensor");
+            return T{};
+        }
 
         T res = data[0];
-        for (u32 i = size(); i-- > 0; ) res = std::max(res, data[i]);
+        each_row([&](const T *p, u32 n) { res = reduce_max(p, n, res); });
         return res;
     }
 
     T min() {
-        if (size() <= 0) THROW(std::runtime_error("attempt to get min of empty tensor"));
+        if (size() <= 0) {
+            THROW(std::runtime_error, "attempt to get min of empty tensor");
+            return T{};
+        }
 
         T res = data[0];
-        for (u32 i = size(); i-- > 0; ) res = std::min(res, data[i]);
+        each_row([&](const T *p, u32 n) { res = reduce_min(p, n, res); });
         return res;
     }
 
     T sum() {
         T res = (T)0;
-        for (u32 i = size(); i-- > 0; ) res += data[i];
+        each_row([&](const T *p, u32 n) { res += reduce_sum(p, n); });
         return res;
     }
 
@@ -137,10 +369,7 @@ public:
     T var() {
         T m = mean();
         T s = (T)0;
-        for (u32 i = size(); i-- > 0; ) {
-            T v = data[i] - m;
-            s += v * v;
-        }
+        each_row([&](const T *p, u32 n) { s += reduce_sum(p, n, [m](auto v) { auto d = v - m; return d * d; }); });
         return s / size();
     }
 
@@ -149,12 +378,12 @@ public:
     }
 
     Tensor &operator-=(T v) & {
-        for (u32 i = size(); i-- > 0; ) data[i] -= v;
+        each_row([&](T *p, u32 n) { for (u32 i = 0; i < n; ++i) p[i] -= v; });
         return *this;
     }
 
     Tensor &operator/=(T v) & {
-        for (u32 i = size(); i-- > 0; ) data[i] /= v;
+        each_row([&](T *p, u32 n) { for (u32 i = 0; i < n; ++i) p[i] /= v; });
         return *this;
     }
 };
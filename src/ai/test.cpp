@@ -2,11 +2,21 @@
 #include <cassert>
 #include <cmath>
 #include <cstring>
+#include <fstream>
 
 #include "./filter.h"
+#include "./dsp.h"
 #include "./tensor.h"
 #include "./util.h"
+#include "./quant.h"
+#include "./half.h"
+#include "./npy.h"
+#include "./pool.h"
+#include "./encoder.h"
+#include "./model.h"
 #include "./tf.h"
+#include "./aot.h"
+#include "./fuse.h"
 
 template<typename T>
 void deleter(T *v) { delete[] v; }
@@ -19,6 +29,25 @@ void deleter(T *v) { delete[] v; }
 #define CATCH(body) {}
 #endif
 
+// how a call that can fail went, whether it throws or hands the error back, so failure checks run in NO_EXCEPTIONS
+// builds too. calls that don't return a Status are checked for a latched error.
+template<typename F>
+Status status_of(F f) {
+    TRY {
+        if constexpr (std::is_same<decltype(f()), Status>::value) {
+            return f();
+        } else {
+            f();
+            return take_error();
+        }
+    } CATCH({
+        static std::string what;
+        what = x.what();
+        return Status{ what.c_str() };
+    })
+    return Status{ nullptr };
+}
+
 int main() {
     std::cout << "starting tests...\n";
 
@@ -48,6 +77,72 @@ int main() {
         throw;
     })
 
+    TRY { // aligned tensor
+        Tensor<f32, 2> t = Tensor<f32, 2>::alloc(AllocPolicy { 32, 32 }, 3, 5);
+        assert(t.dim<0>() == 3 && t.dim<1>() == 5);
+        assert(t.stride() == 8 && !t.contiguous());
+        assert(t.aligned(32));
+        for (u32 i = 0; i < 3; ++i) assert(reinterpret_cast<uintptr_t>(t.row(i)) % 32 == 0);
+
+        t.fill(-100);
+        for (u32 i = 0; i < 3; ++i) {
+            for (u32 j = 0; j < 5; ++j) t(i, j) = i * 5 + j;
+        }
+        assert(&t(1, 0) == t.row(1) && &t(2, 4) == t.row(2) + 4);
+        assert(t.sum() == 105 && t.min() == 0 && t.max() == 14);
+        assert(std::abs(t.mean() - 7) < 0.01 && std::abs(t.var() - 18.6667) < 0.01);
+        t.maximum(2).minimum(12);
+        assert(t(0, 0) == 2 && t(0, 3) == 3 && t(2, 4) == 12);
+
+        Tensor<f32, 2> packed = Tensor<f32, 2>::alloc(packed_alloc_policy, 3, 5);
+        assert(packed.stride() == 5 && packed.contiguous());
+
+        f32 raw[12] = {1, 2, 3, 0, 4, 5, 6, 0, 7, 8, 9, 0};
+        Tensor<f32, 2> view = Tensor<f32, 2>::strided(raw, nullptr, 4, 3, 3);
+        assert(view(1, 0) == 4 && view(2, 2) == 9 && view.sum() == 45);
+        Tensor<f32, 2> owned = static_cast<Tensor<f32, 2>&&>(view).into_owned();
+        raw[4] = 100;
+        assert(owned(1, 0) == 4 && owned(2, 2) == 9 && owned.sum() == 45);
+    } CATCH({
+        std::cout << "!!!! aligned tensor error: " << x.what() << '\n';
+        throw;
+    })
+
+    TRY { // reductions
+        for (u32 n : { 1u, 7u, 31u, 257u, 1000u }) {
+            auto t = Tensor<f32, 2>::alloc(3, n);
+            f64 sum = 0, sq = 0;
+            f32 lo = 1e9f, hi = -1e9f;
+            for (u32 i = 0; i < 3; ++i) {
+                for (u32 j = 0; j < n; ++j) {
+                    const f32 v = std::sin((i * n + j) * 0.37f) * 4 + 1;
+                    t(i, j) = v;
+                    sum += v;
+                    lo = std::min(lo, v);
+                    hi = std::max(hi, v);
+                }
+            }
+            const f64 mean = sum / (3 * n);
+            for (u32 i = 0; i < 3; ++i) for (u32 j = 0; j < n; ++j) sq += (t(i, j) - mean) * (t(i, j) - mean);
+            assert(std::abs(t.sum() - sum) < 1e-4 * (3 * n) && t.min() == lo && t.max() == hi);
+            assert(std::abs(t.var() - sq / (3 * n)) < 1e-3);
+        }
+
+        // pairwise summation keeps a long sum of 0.1 close where a serial accumulator drifts by several units
+        auto tenths = Tensor<f32, 1>::alloc(1 << 20);
+        tenths.fill(0.1f);
+        assert(std::abs(tenths.sum() - 104857.6f) < 0.1f);
+
+        i8 raw[40] = {};
+        raw[29] = 100;
+        raw[3] = -90;
+        Tensor<i8, 1> q { raw, nullptr, 40 };
+        assert(q.max() == 100 && q.min() == -90);
+    } CATCH({
+        std::cout << "!!!! reductions error: " << x.what() << '\n';
+        throw;
+    })
+
     TRY { // complex
         c32 a = c32 {5, 7} * c32 {-4, 1};
         assert(a.real == -27 && a.imag == -23);
@@ -128,6 +223,37 @@ int main() {
         throw;
     })
 
+    TRY { // in-place fft
+        assert(fft_inplace_supported(240) && fft_inplace_supported(4000) && fft_inplace_supported(7) && !fft_inplace_supported(2 * 67));
+
+        for (u32 n : { 2u, 12u, 30u, 120u, 128u }) {
+            std::vector<c32> x(n), expected(n);
+            for (u32 i = 0; i < n; ++i) x[i] = { std::sin(i * 0.37f), std::cos(i * 1.3f) - 0.2f };
+            fft_impl_into(expected.data(), n, x.data(), n, -2 * (f32)PI, 1.0f);
+            fft_inplace(x.data(), n);
+            for (u32 i = 0; i < n; ++i) assert(std::sqrt(sqr_mag(x[i] - expected[i])) < 1e-3f * n);
+        }
+
+        const u32 n = 240;
+        f32 samples[n], packed[n];
+        for (u32 i = 0; i < n; ++i) packed[i] = samples[i] = std::sin(i * 0.05f) + 0.25f * std::sin(i * 0.9f);
+        c32 expected[n / 2 + 1];
+        fft_impl_into(expected, n / 2 + 1, samples, n, -2 * (f32)PI, 1.0f);
+        rfft_inplace(packed, n);
+        const c32 *bins = reinterpret_cast<const c32*>(packed);
+        assert(std::abs(bins[0].real - expected[0].real) < 0.01f && std::abs(bins[0].imag - expected[n / 2].real) < 0.01f);
+        for (u32 i = 1; i < n / 2; ++i) assert(std::sqrt(sqr_mag(bins[i] - expected[i])) < 0.01f);
+        irfft_inplace(packed, n);
+        for (u32 i = 0; i < n; ++i) assert(std::abs(packed[i] - samples[i]) < 1e-4f);
+
+        // at 8 kHz neither the low pass nor the frames need a spectrum buffer of their own
+        const FrontendPlan<f32> plan = FrontendPlan<f32>::for_learning(8000, 8000.0f);
+        assert(plan.buffers[FrontendPlan<f32>::LOWPASS].size == 0 && plan.buffers[FrontendPlan<f32>::BINS].size == 0);
+    } CATCH({
+        std::cout << "!!!! in-place fft error: " << x.what() << '\n';
+        throw;
+    })
+
     TRY { // low_pass_filter
         f32 sig_raw[] = {1, 2, 3, 4, 5, 6, 2, 3, 8, 1};
         Tensor<f32, 1> sig { sig_raw, nullptr, sizeof(sig_raw) / sizeof(*sig_raw) };
@@ -287,6 +413,39 @@ int main() {
         throw;
     })
 
+    TRY { // transpose kernels
+        const u32 shapes[][2] = { {1, 1}, {3, 40}, {37, 53}, {64, 17} };
+        for (const auto &shape : shapes) {
+            Tensor<f32, 2> a = Tensor<f32, 2>::alloc(shape[0], shape[1]);
+            for (u32 i = 0; i < shape[0]; ++i) for (u32 j = 0; j < shape[1]; ++j) a(i, j) = i * 100 + j;
+
+            Tensor<f32, 2> t = transpose(a);
+            assert(t.dim<0>() == shape[1] && t.dim<1>() == shape[0]);
+            for (u32 i = 0; i < shape[0]; ++i) for (u32 j = 0; j < shape[1]; ++j) assert(t(j, i) == a(i, j));
+        }
+
+        f32 raw[12] = {1, 2, 3, 0, 4, 5, 6, 0, 7, 8, 9, 0};
+        Tensor<f32, 2> view = Tensor<f32, 2>::strided(raw, nullptr, 4, 3, 3);
+        Tensor<f32, 2> vt = transpose(view);
+        assert(vt(0, 1) == 4 && vt(1, 0) == 2 && vt(2, 1) == 6);
+
+        c32 cr[] = { {1, 2}, {3, 0}, {0, -1}, {2, 2}, {1, 1}, {0, 0} };
+        Tensor<c32, 2> c { cr, nullptr, 2, 3 };
+        Tensor<f32, 2> p = transpose_map(c, [](const c32 &v) { return sqr_mag(v); });
+        assert(p.dim<0>() == 3 && p.dim<1>() == 2);
+        assert(p(0, 0) == 5 && p(1, 0) == 9 && p(2, 0) == 1 && p(0, 1) == 8 && p(1, 1) == 2 && p(2, 1) == 0);
+
+        for (u32 n : {5u, 40u}) {
+            Tensor<f32, 2> sq = Tensor<f32, 2>::alloc(n, n);
+            for (u32 i = 0; i < n; ++i) for (u32 j = 0; j < n; ++j) sq(i, j) = i * 100 + j;
+            transpose_inplace(sq);
+            for (u32 i = 0; i < n; ++i) for (u32 j = 0; j < n; ++j) assert(sq(i, j) == j * 100 + i);
+        }
+    } CATCH({
+        std::cout << "!!!! transpose kernels error: " << x.what() << '\n';
+        throw;
+    })
+
     TRY { // matmul
         f32 a_raw[] = { 1, 2, 3, 4, 5, 6 };
         Tensor<f32, 2> a { a_raw, nullptr, 2, 3 };
@@ -309,6 +468,29 @@ int main() {
         throw;
     })
 
+    TRY { // matmul kernels
+        const u32 shapes[][3] = { {2, 3, 1}, {7, 5, 1}, {16, 120, 65}, {16, 16, 65}, {5, 9, 3}, {37, 53, 29}, {70, 300, 531} };
+        for (const auto &shape : shapes) {
+            Tensor<f64, 2> a = Tensor<f64, 2>::alloc(shape[0], shape[1]);
+            Tensor<f64, 2> b = Tensor<f64, 2>::alloc(shape[1], shape[2]);
+            for (u32 i = 0; i < shape[0]; ++i) for (u32 j = 0; j < shape[1]; ++j) a(i, j) = (f64)((i * 7 + j * 3) % 11) - 5;
+            for (u32 i = 0; i < shape[1]; ++i) for (u32 j = 0; j < shape[2]; ++j) b(i, j) = (f64)((i * 5 + j * 13) % 7) - 3;
+
+            Tensor<f64, 2> c = matmul(a, b);
+            assert(c.dim<0>() == shape[0] && c.dim<1>() == shape[2]);
+            for (u32 i = 0; i < shape[0]; ++i) {
+                for (u32 j = 0; j < shape[2]; ++j) {
+                    f64 expect = 0;
+                    for (u32 k = 0; k < shape[1]; ++k) expect += a(i, k) * b(k, j);
+                    assert(c(i, j) == expect);
+                }
+            }
+        }
+    } CATCH({
+        std::cout << "!!!! matmul kernels error: " << x.what() << '\n';
+        throw;
+    })
+
     TRY { // mfcc spectrogram
         f64 sig_raw[] = {1, 2, 3, 4, 5, 6, 2, 3, 8, 1, 7, 2, 5, 2, 6, 4, 7, 2, 4, 7, 1, 3, 6, 3, 1, 6};
         Tensor<f64, 1> sig { sig_raw, nullptr, sizeof(sig_raw) / sizeof(*sig_raw) };
@@ -458,6 +640,421 @@ int main() {
         throw;
     })
 
+    TRY { // buffer planner
+        BufferSpec specs[] = { { 100, 8, 0, 1 }, { 60, 8, 1, 2 }, { 40, 8, 2, 3 }, { 100, 8, 3, 3 }, { 10, 16, 0, 3 } };
+        const u32 n = sizeof(specs) / sizeof(*specs);
+        u32 offsets[n];
+        const u32 total = plan_buffers(specs, n, offsets);
+        assert(total >= max_live_bytes(specs, n) && total < 310);
+        for (u32 i = 0; i < n; ++i) {
+            assert(offsets[i] % specs[i].align == 0 && offsets[i] + specs[i].size <= total);
+            for (u32 j = 0; j < i; ++j) {
+                if (lifetimes_overlap(specs[i], specs[j])) assert(offsets[i] + specs[i].size <= offsets[j] || offsets[j] + specs[j].size <= offsets[i]);
+            }
+        }
+
+        f64 sig_raw[] = {1, 2, 3, 4, 5, 6, 2, 3, 8, 1, 7, 2, 5, 2, 6, 4, 7, 2, 4, 7, 1, 3, 6, 3, 1, 6};
+        const u32 len = sizeof(sig_raw) / sizeof(*sig_raw);
+        f64 sig_copy[len];
+        std::memcpy(sig_copy, sig_raw, sizeof(sig_raw));
+        Tensor<f64, 1> sig { sig_raw, nullptr, len }, sig2 { sig_copy, nullptr, len };
+
+        auto plan = FrontendPlan<f64>::for_learning(len, 200.0);
+        assert(plan.fft_size == 6 && plan.chunks == 7);
+        assert(plan.region_size >= max_live_bytes(plan.buffers, plan.BUFFER_COUNT) && plan.region_size < plan.unplanned_size());
+        u8 *region = aligned_new<u8>(plan.region_size);
+
+        Tensor<f64, 2> expected = mfcc_spectrogram_for_learning(sig, 200.0);
+        Tensor<f64, 2> x = mfcc_spectrogram_for_learning(sig2, plan, region);
+        assert(x.dim<0>() == 16 && x.dim<1>() == 7);
+        assert(x.row(0) >= reinterpret_cast<f64*>(region) && x.row(15) + 7 <= reinterpret_cast<f64*>(region + plan.region_size));
+        for (u32 i = 0; i < 16; ++i) for (u32 j = 0; j < 7; ++j) assert(x(i, j) == expected(i, j));
+        aligned_delete(region);
+
+        auto big = FrontendPlan<f32>::for_learning(8000, 8000.0f);
+        assert(big.fft_size == 240 && big.chunks == 65);
+        assert(big.region_size == max_live_bytes(big.buffers, big.BUFFER_COUNT));
+    } CATCH({
+        std::cout << "!!!! buffer planner error: " << x.what() << '\n';
+        throw;
+    })
+
+    TRY { // pool allocator
+        for (u32 size : { 1u, 16u, 17u, 100u, 1000u, 4097u, 33000u }) assert(pool_class_size(size) >= size && pool_class_size(size) <= std::max(16u, size + size / 4));
+        assert(pool_class_size(0) == 16 && pool_class_size(20) == 20 && pool_class_size(21) == 24 && pool_class_size(257) == 320);
+
+        pool_reset_stats();
+        const PoolStats before = pool_stats(REGION_SHARED);
+
+        void *a = pool_alloc(100, REGION_SHARED);
+        void *b = pool_alloc(3000, REGION_EXTENDED);
+        assert(pool_region_of(a) == REGION_SHARED && pool_region_of(b) == REGION_EXTENDED);
+        assert(reinterpret_cast<uintptr_t>(a) % alignof(std::max_align_t) == 0 && reinterpret_cast<uintptr_t>(b) % alignof(std::max_align_t) == 0);
+        assert(pool_stats(REGION_SHARED).live_bytes == before.live_bytes + 100 && pool_stats(REGION_SHARED).allocs == before.allocs + 1);
+
+        pool_free(a);
+        assert(pool_stats(REGION_SHARED).live_bytes == before.live_bytes && pool_stats(REGION_SHARED).peak_bytes >= before.live_bytes + 100);
+        void *c = pool_alloc(97, REGION_SHARED);
+        assert(c == a); // same size class, so the freed block is reused
+        pool_free(c);
+        pool_free(b);
+
+        {
+            RegionScope scope(REGION_SHARED);
+            Tensor<f32, 2> t = Tensor<f32, 2>::alloc(16, 65);
+            std::vector<int> v(10);
+            assert(pool_region_of(reinterpret_cast<void**>(t.row(0))[-1]) == REGION_SHARED && pool_region_of(v.data()) == REGION_SHARED);
+        }
+        assert(pool_hint() == REGION_TCM);
+
+        void *big = pool_alloc(POOL_TCM_SIZE + 1, REGION_TCM);
+        assert(pool_region_of(big) != REGION_TCM && pool_stats(REGION_TCM).fallbacks >= 1);
+        pool_free(big);
+
+        void *sys = pool_alloc(64, REGION_SYSTEM);
+        assert(pool_region_of(sys) == REGION_SYSTEM);
+        pool_free(sys);
+
+        const PoolStats &total = pool_stats(REGION_ALL);
+        assert(total.allocs >= 6 && total.frees >= 6 && total.peak_bytes >= total.live_bytes);
+    } CATCH({
+        std::cout << "!!!! pool allocator error: " << x.what() << '\n';
+        throw;
+    })
+
+    TRY { // allocation trace
+        const u32 len = 8000;
+        auto clip = Tensor<f32, 1>::alloc(len);
+        for (u32 i = 0; i < len; ++i) clip(i) = std::sin(i * 0.05f) * 0.3f;
+
+        pool_trace(true);
+        Tensor<f32, 2> features = mfcc_spectrogram_for_learning(clip, 8000.0f);
+        Tensor<f32, 1> embedding = inference(features);
+        pool_trace(false);
+        assert(pool_stage() == STAGE_NONE);
+
+        for (Stage s : { STAGE_SPECTROGRAM, STAGE_MEL, STAGE_DCT, STAGE_INFERENCE }) assert(pool_trace_stats(s).allocs > 0 && pool_trace_stats(s).bytes > 0);
+        assert(pool_trace_stats(STAGE_SPECTROGRAM).frees > 0 && pool_trace_stats(STAGE_SPECTROGRAM).max_lifetime > 0);
+        assert(pool_trace_stats(STAGE_MEL).peak_bytes >= pool_trace_stats(STAGE_SPECTROGRAM).bytes / 2);
+        assert(pool_trace_stats(STAGE_NORMALIZE).allocs == 0);
+
+        // the report doubles as a test artifact so memory regressions show up in review
+        static std::ofstream report;
+        report.open("test-alloc-trace.txt");
+        pool_trace_report([](const char *line) { report << line << '\n'; });
+        report.close();
+        assert(report.good());
+    } CATCH({
+        std::cout << "!!!! allocation trace error: " << x.what() << '\n';
+        throw;
+    })
+
+    TRY { // inference sessions
+        const u32 len = 8000;
+        auto clip = Tensor<f32, 1>::alloc(len);
+        for (u32 i = 0; i < len; ++i) clip(i) = std::sin(i * 0.05f) * 0.3f + std::sin(i * 0.71f) * 0.1f;
+        Tensor<f32, 2> features = mfcc_spectrogram_for_learning(clip, 8000.0f);
+        Tensor<f32, 1> expected = inference(features);
+
+        // one session in a caller's arena, one in its own; neither touches the default one
+        alignas(TENSOR_ALIGN) static u8 arena[TENSOR_ARENA_SIZE];
+        InferenceSession a(arena, sizeof(arena)), b;
+        assert(!a.status().ok() && a.output_size() == 0 && a.run(features).dim<0>() == 0);
+        assert(a.load(model_tflite, model_tflite_len).ok() && b.load(model_tflite, model_tflite_len).ok());
+        assert(a.output_size() == expected.dim<0>() && b.output_size() == expected.dim<0>());
+        assert(a.scratch().data >= arena && a.scratch().data + a.scratch().size <= arena + sizeof(arena));
+
+        Tensor<f32, 1> from_a = a.run(features), from_b = b.run(features);
+        for (u32 i = 0; i < expected.dim<0>(); ++i) assert(from_a(i) == expected(i) && from_b(i) == expected(i));
+        assert(a.output().row(0) != b.output().row(0) && a.output().row(0) != inference_output().row(0));
+
+        static const u8 junk[64] = { 0x1c, 0, 0, 0, 'T', 'F', 'L', '3' };
+        assert(!status_of([&] { return a.load(junk, sizeof(junk)); }).ok());
+        assert(!a.status().ok() && b.status().ok());
+    } CATCH({
+        std::cout << "!!!! inference sessions error: " << x.what() << '\n';
+        throw;
+    })
+
+    TRY { // conv leaky fusion
+        // the fused model is a new front ahead of the original, which keeps its alignment
+        const u32 size = conv_leaky_fused_size(model_tflite, model_tflite_len);
+        assert(size > model_tflite_len && (size - model_tflite_len) % 16 == 0);
+        std::vector<u8> buf(size);
+        std::memcpy(buf.data(), model_tflite, model_tflite_len);
+        assert(fuse_conv_leaky(buf.data(), model_tflite_len, size - 1) == model_tflite_len);
+        assert(std::memcmp(buf.data(), model_tflite, model_tflite_len) == 0);
+        assert(fuse_conv_leaky(buf.data(), model_tflite_len, size) == size);
+        assert(conv_leaky_fused_size(buf.data(), size) == size);
+
+        // the tensors between the fused ops are dropped, so every tensor left is still written or read by something
+        using namespace conv_leaky;
+        const FlatTable root = { buf.data() + FlatTable::load<u32>(buf.data()) }, graph = root.item(MODEL_SUBGRAPHS, 0);
+        const u32 tensors = graph.count(GRAPH_TENSORS);
+        const FlatTable original = FlatTable{ model_tflite + FlatTable::load<u32>(model_tflite) }.item(MODEL_SUBGRAPHS, 0);
+        assert(tensors < original.count(GRAPH_TENSORS));
+        std::vector<bool> used(tensors);
+        for (u32 k = 0; k < graph.count(GRAPH_OUTPUTS); ++k) used[graph.element<i32>(GRAPH_OUTPUTS, k)] = true;
+        for (u32 k = 0; k < graph.count(GRAPH_INPUTS); ++k) used[graph.element<i32>(GRAPH_INPUTS, k)] = true;
+        for (u32 i = 0; i < graph.count(GRAPH_OPERATORS); ++i) {
+            const FlatTable op = graph.item(GRAPH_OPERATORS, i);
+            for (u32 f = OP_INPUTS; f <= OP_OUTPUTS; ++f) for (u32 k = 0; k < op.count(f); ++k) {
+                const i32 t = op.element<i32>(f, k);
+                assert(t >= -1 && t < (i32)tensors);
+                if (t >= 0) used[t] = true;
+            }
+        }
+        for (u32 t = 0; t < tensors; ++t) assert(used[t]);
+    } CATCH({
+        std::cout << "!!!! conv leaky fusion error: " << x.what() << '\n';
+        throw;
+    })
+
+    TRY { // batched inference
+        const u32 len = 8000, batch = 3;
+        Tensor<f32, 1> single[batch];
+        Tensor<f32, 3> features = Tensor<f32, 3>::alloc(batch, 16, 65);
+        for (u32 b = 0; b < batch; ++b) {
+            auto clip = Tensor<f32, 1>::alloc(len);
+            for (u32 i = 0; i < len; ++i) clip(i) = std::sin(i * (0.05f + 0.1f * b)) * 0.3f;
+            Tensor<f32, 2> f = mfcc_spectrogram_for_learning(clip, 8000.0f);
+            for (u32 i = 0; i < 16; ++i) for (u32 j = 0; j < 65; ++j) features(b, i, j) = f(i, j);
+            single[b] = inference(f);
+        }
+
+        Tensor<f32, 2> embeddings = inference_batch(features);
+        assert(embeddings.dim<0>() == batch && embeddings.dim<1>() == inference_output_size());
+        for (u32 b = 0; b < batch; ++b) for (u32 i = 0; i < embeddings.dim<1>(); ++i) assert(embeddings(b, i) == single[b](i));
+
+        auto wrong = Tensor<f32, 2>::alloc(batch - 1, inference_output_size());
+        assert(!status_of([&] { return inference_batch_into(wrong, features); }).ok());
+    } CATCH({
+        std::cout << "!!!! batched inference error: " << x.what() << '\n';
+        throw;
+    })
+
+    TRY { // inference profile
+        const u32 len = 8000;
+        auto clip = Tensor<f32, 1>::alloc(len);
+        for (u32 i = 0; i < len; ++i) clip(i) = std::sin(i * 0.05f) * 0.3f;
+        Tensor<f32, 2> features = mfcc_spectrogram_for_learning(clip, 8000.0f);
+        Tensor<f32, 1> plain = inference(features);
+
+        inference_profile(true);
+        Tensor<f32, 1> profiled = inference(features);
+        inference(features);
+        inference_profile(false);
+        for (u32 i = 0; i < plain.dim<0>(); ++i) assert(plain(i) == profiled(i));
+
+        static std::string report;
+        report.clear();
+        inference_profile_report([](const char *line) { report += line; report += '\n'; });
+        assert(report.find("2 invocations") != std::string::npos);
+        assert(report.find(CONV_LEAKY_OP) != std::string::npos && report.find("FULLY_CONNECTED") != std::string::npos);
+    } CATCH({
+        std::cout << "!!!! inference profile error: " << x.what() << '\n';
+        throw;
+    })
+
+    TRY { // model hot swap
+        const u32 len = 8000;
+        static f32 clip[len], input[len];
+        for (u32 i = 0; i < len; ++i) clip[i] = std::sin(i * 0.05f) * 0.3f + std::sin(i * 0.71f) * 0.1f;
+        Encoder encoder;
+        f32 before[16], after[16];
+        assert(encoder.init(len, 8000.0f).ok());
+        std::memcpy(input, clip, sizeof(clip));
+        assert(encoder.encode(input, len, 8000.0f, before, 16).ok());
+        const u32 generation = inference_generation();
+
+        // junk fails verification and the running model keeps serving
+        static const u8 junk[64] = { 0x1c, 0, 0, 0, 'T', 'F', 'L', '3' };
+        assert(!status_of([&] { return inference_load(junk, sizeof(junk)); }).ok());
+        assert(!status_of([&] { return inference_swap(); }).ok() && take_error().ok());
+        assert(inference_generation() == generation && encoder.ready_for(len, 8000.0f));
+
+        // the same flatbuffer from a file comes up in the standby arena; the encoder follows the swap on its own
+        {
+            std::ofstream f("test-model.tflite", std::ios::binary);
+            f.write(reinterpret_cast<const char*>(model_tflite), model_tflite_len);
+        }
+        assert(inference_load_file("test-model.tflite").ok());
+        std::memcpy(input, clip, sizeof(clip));
+        assert(encoder.encode(input, len, 8000.0f, after, 16).ok());
+        for (u32 i = 0; i < 16; ++i) assert(after[i] == before[i]);
+        assert(inference_swap().ok() && inference_generation() == generation + 1 && !encoder.ready_for(len, 8000.0f));
+        std::memcpy(input, clip, sizeof(clip));
+        assert(encoder.encode(input, len, 8000.0f, after, 16).ok() && encoder.ready_for(len, 8000.0f));
+        for (u32 i = 0; i < 16; ++i) assert(after[i] == before[i]);
+
+        // the old model is still in standby, so swapping again rolls back
+        assert(inference_swap().ok() && inference_generation() == generation + 2);
+        std::remove("test-model.tflite");
+    } CATCH({
+        std::cout << "!!!! model hot swap error: " << x.what() << '\n';
+        throw;
+    })
+
+    TRY { // zero heap encode
+        const u32 len = 8000;
+        static f32 clip[len], input[len], output[16];
+        for (u32 i = 0; i < len; ++i) clip[i] = std::sin(i * 0.05f) * 0.3f + std::sin(i * 0.71f) * 0.1f;
+
+        Encoder encoder;
+        assert(encoder.init(len, 8000.0f).ok() && encoder.ready_for(len, 8000.0f));
+        f32 expected[16];
+        std::memcpy(input, clip, sizeof(clip));
+        assert(encoder.encode(input, len, 8000.0f, expected, 16).ok());
+
+        pool_reset_stats();
+        pool_seal(true);
+        for (u32 k = 0; k < 3; ++k) {
+            std::memcpy(input, clip, sizeof(clip));
+            assert(encoder.encode(input, len, 8000.0f, output, 16).ok());
+        }
+        pool_seal(false);
+        assert(pool_stats(REGION_ALL).allocs == 0 && pool_stats(REGION_ALL).sealed_allocs == 0);
+        for (u32 i = 0; i < 16; ++i) assert(output[i] == expected[i]);
+
+        // a clip shape whose frontend doesn't fit in the arena gets its buffer at init, before the pool is sealed
+        static f32 longer[2 * len] = {};
+        Encoder large;
+        assert(large.init(2 * len, 16000.0f).ok() && !large.borrows_arena());
+        pool_reset_stats();
+        pool_seal(true);
+        assert(large.encode(longer, 2 * len, 16000.0f, output, 16).ok());
+        pool_seal(false);
+        assert(pool_stats(REGION_ALL).sealed_allocs == 0);
+
+        // a new clip shape is not covered by init, so it has to allocate, which ZERO_HEAP builds refuse
+        pool_seal(true);
+#ifdef ZERO_HEAP
+        assert(!encoder.encode(longer, 2 * len, 16000.0f, output, 16).ok());
+        Encoder late;
+        assert(!late.init(2 * len, 16000.0f).ok());
+#else
+        assert(encoder.encode(longer, 2 * len, 16000.0f, output, 16).ok());
+#endif
+        pool_seal(false);
+#ifndef ZERO_HEAP
+        assert(pool_stats(REGION_ALL).sealed_allocs > 0);
+#endif
+    } CATCH({
+        std::cout << "!!!! zero heap encode error: " << x.what() << '\n';
+        throw;
+    })
+
+    TRY { // zero copy encode
+        const u32 len = 8000;
+        static f32 clip[len], input[len];
+        for (u32 i = 0; i < len; ++i) clip[i] = std::sin(i * 0.03f) * 0.4f;
+
+        // the default arena is sized so this clip shape's frontend fits in its idle part
+        Encoder encoder;
+        assert(encoder.init(len, 8000.0f).ok() && encoder.borrows_arena());
+        assert(inference_scratch().size >= FrontendPlan<f32>::for_learning(len, 8000.0f, inference_input_q8().dim<0>() == 0).region_size);
+        assert(!encoder.init(len / 2, 8000.0f).ok() && !encoder.ready_for(len / 2, 8000.0f));
+        assert(encoder.init(len, 8000.0f).ok());
+
+        std::memcpy(input, clip, sizeof(clip));
+        Tensor<f32, 1> embedding;
+        pool_reset_stats();
+        assert(encoder.encode(input, len, 8000.0f, embedding).ok());
+        assert(pool_stats(REGION_ALL).allocs == 0);
+        assert(embedding.dim<0>() == inference_output_size() && embedding.row(0) == inference_output().row(0));
+
+        // the frontend wrote its result into the model input
+        std::memcpy(input, clip, sizeof(clip));
+        Tensor<f32, 1> signal { input, nullptr, len };
+        Tensor<f32, 2> features = mfcc_spectrogram_for_learning(signal, 8000.0f), view = inference_input();
+        for (u32 i = 0; i < 16; ++i) for (u32 j = 0; j < 65; ++j) assert(std::abs(view(i, j) - features(i, j)) < 1e-4f);
+
+        // the compiled model has the same views
+        Tensor<f32, 2> aot_in = aot_input();
+        for (u32 i = 0; i < 16; ++i) for (u32 j = 0; j < 65; ++j) aot_in(i, j) = view(i, j);
+        assert(aot_invoke().ok());
+        Tensor<f32, 1> aot_out = aot_output(), aot_ref = aot_inference(view);
+        for (u32 i = 0; i < 16; ++i) assert(aot_out(i) == aot_ref(i));
+    } CATCH({
+        std::cout << "!!!! zero copy encode error: " << x.what() << '\n';
+        throw;
+    })
+
+    TRY { // int8 model input
+        const u32 len = 8000;
+        static f32 clip[len];
+        for (u32 i = 0; i < len; ++i) clip[i] = std::sin(i * 0.02f) * 0.5f + std::sin(i * 0.37f) * 0.1f;
+        Tensor<f32, 1> signal { clip, nullptr, len };
+        Tensor<f32, 2> features = mfcc_spectrogram(signal, learning_fft_size(8000.0f), 8000.0f, 16, 16);
+
+        // the fused tail quantizes exactly what normalize_for_learning would have produced
+        QTensor<i8, 2> fused = aot_input_q8();
+        assert(fused.dim<0>() == 16 && fused.dim<1>() == 65);
+        normalize_for_learning_into(fused, features);
+        normalize_for_learning(features);
+        for (u32 i = 0; i < 16; ++i) for (u32 j = 0; j < 65; ++j) assert(fused.data(i, j) == quantize_value<i8>(features(i, j), fused.params));
+
+        // and entering the model after its quantize op gives the same embedding as the f32 entry
+        assert(aot_invoke_q8().ok());
+        Tensor<f32, 1> direct = aot_output(), through_f32 = aot_inference(features);
+        for (u32 i = 0; i < 16; ++i) assert(direct(i) == through_f32(i));
+    } CATCH({
+        std::cout << "!!!! int8 model input error: " << x.what() << '\n';
+        throw;
+    })
+
+    TRY { // streaming inference
+        const u32 hop = aot_stream_hop(), hops = 4, cols = 65 + hop * hops;
+        assert(hop == 16);
+        auto features = Tensor<f32, 2>::alloc(16, cols);
+        for (u32 i = 0; i < 16; ++i) for (u32 j = 0; j < cols; ++j) features(i, j) = std::sin(i * 0.7f + j * 0.13f) * std::cos(j * 0.05f);
+
+        aot_stream_reset();
+        assert(!aot_stream_ready());
+        auto res = Tensor<f32, 1>::alloc(aot_output_size());
+        assert(!status_of([&] { return aot_stream_output(res); }).ok());
+
+        // a full window, then a hop at a time; every output matches running the whole window
+        for (u32 start = 0, pushed = 0; start + 65 <= cols; start += hop) {
+            const u32 end = start + 65;
+            Tensor<f32, 2> fresh = Tensor<f32, 2>::strided(features.row(0) + pushed, nullptr, cols, 16, end - pushed);
+            assert(aot_stream_push(fresh).ok());
+            pushed = end;
+            assert(aot_stream_ready() && aot_stream_output(res).ok());
+
+            Tensor<f32, 2> window = Tensor<f32, 2>::strided(features.row(0) + start, nullptr, cols, 16, 65);
+            Tensor<f32, 1> whole = aot_inference(window);
+            for (u32 i = 0; i < whole.dim<0>(); ++i) assert(res(i) == whole(i));
+        }
+    } CATCH({
+        std::cout << "!!!! streaming inference error: " << x.what() << '\n';
+        throw;
+    })
+
+    TRY { // error latching
+        assert(take_error().ok());
+        raise_error("first");
+        raise_error("second");
+        assert(!pending_error().ok());
+        const Status status = take_error();
+        assert(!status.ok() && std::strcmp(status.error, "first") == 0);
+        assert(pending_error().ok() && take_error().ok());
+
+        // a failing call hands back its message, not the expression that would have thrown it
+        const char *message = nullptr;
+        TRY {
+            Tensor<f32, 1> empty;
+            empty.max();
+            message = take_error().error;
+        } CATCH({
+            message = x.what();
+        })
+        assert(message && std::strcmp(message, "attempt to get max of empty tensor") == 0);
+    } CATCH({
+        std::cout << "!!!! error latching error: " << x.what() << '\n';
+        throw;
+    })
+
     TRY { // inference
         f32 sig_raw[] = {
 -0.0011146776378154755, 0.0042790696024894714, -0.008131816983222961, -0.020017728209495544, -0.016952985897660255, -0.018140768632292747, -0.032759666442871094, -0.033158864825963974, -0.03552606329321861, -0.03607349097728729, 
@@ -1283,11 +1880,167 @@ int main() {
         assert(std::abs(embed(13) - +0.03444605) < 0.085);
         assert(std::abs(embed(14) - -0.02109118) < 0.085);
         assert(std::abs(embed(15) - +0.04015120) < 0.085);
+
+        // the compiled model runs the interpreter's kernels op for op, so it has to give the same bytes
+        Tensor<f32, 1> compiled = aot_inference(sig_prep);
+        assert(compiled.dim<0>() == embed.dim<0>());
+        for (u32 i = 0; i < embed.dim<0>(); ++i) assert(compiled(i) == embed(i));
+
+        // fusing conv2d with its leaky relu runs the same arithmetic, so the interpreter running the fused op gives
+        // the same bytes as it does on the unfused model (fusion is set on both, since the default is per platform)
+        InferenceSession plain, fused;
+        plain.fuse(false);
+        fused.fuse(true);
+        assert(plain.load(model_tflite, model_tflite_len).ok() && fused.load(model_tflite, model_tflite_len).ok());
+        assert(fused.ops() < plain.ops());
+        fused.profile(true);
+        Tensor<f32, 1> unfused_embed = plain.run(sig_prep), fused_embed = fused.run(sig_prep);
+        fused.profile(false);
+        static std::string fused_report;
+        fused_report.clear();
+        fused.profile_report([](const char *line) { fused_report += line; fused_report += '\n'; });
+        assert(fused_report.find(CONV_LEAKY_OP) != std::string::npos);
+        assert(unfused_embed.dim<0>() == embed.dim<0>() && fused_embed.dim<0>() == embed.dim<0>());
+        for (u32 i = 0; i < embed.dim<0>(); ++i) assert(fused_embed(i) == unfused_embed(i) && fused_embed(i) == embed(i));
     } CATCH({
         std::cout << "!!!! inference error: " << x.what() << '\n';
         throw;
     })
 
+    TRY { // quantization
+        QParams p = choose_qparams<i8>(-1.0f, 3.0f);
+        assert(std::abs(p.scale - 4.0f / 255) < 1e-6 && p.zero_point == -64);
+        assert(quantize_value<i8>(0.0f, p) == p.zero_point);
+        assert(quantize_value<i8>(100.0f, p) == 127 && quantize_value<i8>(-100.0f, p) == -128);
+
+        f32 raw[] = {-1.0f, -0.3f, 0.0f, 0.25f, 1.7f, 3.0f};
+        Tensor<f32, 2> x { raw, nullptr, 2, 3 };
+        QTensor<i8, 2> q = quantize<i8>(x, p);
+        assert(q.dim<0>() == 2 && q.dim<1>() == 3);
+        Tensor<f32, 2> back = dequantize(q);
+        for (u32 i = 0; i < 2; ++i) for (u32 j = 0; j < 3; ++j) assert(std::abs(back(i, j) - x(i, j)) <= p.scale / 2 + 1e-6);
+        assert(q.get(0, 2) == 0);
+
+        QMultiplier m = quantize_multiplier(0.3);
+        assert(multiply_by_quantized_multiplier(1000, m) == 300 && multiply_by_quantized_multiplier(-1000, m) == -300);
+        m = quantize_multiplier(3.5);
+        assert(multiply_by_quantized_multiplier(100, m) == 350);
+
+        QTensor<i16, 2> wide = requantize<i16>(q, choose_symmetric_qparams<i16>(3.0f));
+        for (u32 i = 0; i < 2; ++i) for (u32 j = 0; j < 3; ++j) assert(std::abs(wide.get(i, j) - q.get(i, j)) < 0.001);
+        QTensor<i8, 2> narrow = requantize<i8>(wide, p);
+        for (u32 i = 0; i < 2; ++i) for (u32 j = 0; j < 3; ++j) assert(narrow.data(i, j) == q.data(i, j));
+
+        i8 u[] = {1, -3, 5, 7, 2}, v[] = {-2, 4, 0, 1, 3};
+        assert(qdot(u, 1, v, -2, 5) == 0 * 0 + -4 * 6 + 4 * 2 + 6 * 3 + 1 * 5);
+        assert(ql2_norm_sqr(u, v, 5) == 9 + 49 + 25 + 36 + 1);
+
+        Tensor<f32, 2> a = Tensor<f32, 2>::alloc(5, 7), b = Tensor<f32, 2>::alloc(7, 4);
+        for (u32 i = 0; i < 5; ++i) for (u32 j = 0; j < 7; ++j) a(i, j) = std::sin(i * 7.0f + j);
+        for (u32 i = 0; i < 7; ++i) for (u32 j = 0; j < 4; ++j) b(i, j) = std::cos(i * 3.0f + j) * 0.5f;
+        Tensor<f32, 2> c = matmul(a, b);
+        QTensor<i8, 2> qa = quantize<i8>(a), qb = quantize<i8>(b);
+        QTensor<i8, 2> qc = qmatmul(qa, qb, choose_qparams<i8>(c.min(), c.max()));
+        for (u32 i = 0; i < 5; ++i) for (u32 j = 0; j < 4; ++j) assert(std::abs(qc.get(i, j) - c(i, j)) < 0.05);
+    } CATCH({
+        std::cout << "!!!! quantization error: " << x.what() << '\n';
+        throw;
+    })
+
+    TRY { // half precision
+        assert(to_f16(1.0f).bits == 0x3c00 && to_f16(-2.0f).bits == 0xc000);
+        assert(to_f16(65504.0f).bits == 0x7bff && to_f16(65520.0f).bits == 0x7c00);
+        assert(to_f16(std::ldexp(1.0f, -24)).bits == 0x0001 && to_f16(1e-8f).bits == 0);
+        assert(to_f32(f16 { 0x3555 }) == 0.333251953125f && to_f32(f16 { 0x0200 }) == std::ldexp(1.0f, -15));
+        assert(to_f32(to_f16(NAN)) != to_f32(to_f16(NAN)));
+
+        assert(to_bf16(1.0f).bits == 0x3f80 && to_f32(bf16 { 0xc040 }) == -3.0f);
+        assert(to_bf16(1.00390625f).bits == 0x3f80 && to_bf16(1.01171875f).bits == 0x3f82);
+
+        Tensor<f32, 2> x = Tensor<f32, 2>::alloc(3, 37);
+        for (u32 i = 0; i < 3; ++i) for (u32 j = 0; j < 37; ++j) x(i, j) = std::sin(i * 37.0f + j) * 100;
+        Tensor<f16, 2> h = to_half<f16>(x);
+        Tensor<bf16, 2> b = to_half<bf16>(x);
+        assert(h.dim<0>() == 3 && h.dim<1>() == 37);
+        for (u32 i = 0; i < 3; ++i) for (u32 j = 0; j < 37; ++j) assert(h(i, j).bits == to_f16(x(i, j)).bits && b(i, j).bits == to_bf16(x(i, j)).bits);
+
+        Tensor<f32, 2> hx = to_float(h), bx = to_float(b);
+        for (u32 i = 0; i < 3; ++i) {
+            for (u32 j = 0; j < 37; ++j) {
+                assert(std::abs(hx(i, j) - x(i, j)) <= std::abs(x(i, j)) / 2048);
+                assert(std::abs(bx(i, j) - x(i, j)) <= std::abs(x(i, j)) / 256);
+            }
+        }
+
+        // batches take the f16c path on x86 hosts that have it, which has to round like to_f16 on every edge
+        const f32 edges[] = { 0.0f, -0.0f, 1.0f + std::ldexp(1.0f, -11), 1.0f + 3 * std::ldexp(1.0f, -11), 65504.0f, 65519.0f, 65520.0f, -1e9f,
+                              std::ldexp(1.0f, -14), std::ldexp(1.5f, -24), std::ldexp(1.0f, -25), std::ldexp(1.0f, -26), 1e-8f, INFINITY, -INFINITY, 0.1f, 3.14159f };
+        const u32 n = sizeof(edges) / sizeof(edges[0]);
+        f16 batch[n], single[n];
+        f32 back[n];
+        convert(edges, batch, n);
+        convert(batch, back, n);
+        for (u32 i = 0; i < n; ++i) {
+            single[i] = to_f16(edges[i]);
+            assert(batch[i].bits == single[i].bits && back[i] == to_f32(single[i]));
+        }
+#if defined(HALF_F16C)
+        if (has_f16c()) {
+            convert_f16c(edges, batch, n);
+            convert_f16c(single, back, n);
+            for (u32 i = 0; i < n; ++i) assert(batch[i].bits == single[i].bits && back[i] == to_f32(single[i]));
+        }
+#endif
+    } CATCH({
+        std::cout << "!!!! half precision error: " << x.what() << '\n';
+        throw;
+    })
+
+    TRY { // npy
+        Tensor<f32, 2> x = Tensor<f32, 2>::alloc(5, 7);
+        for (u32 i = 0; i < 5; ++i) for (u32 j = 0; j < 7; ++j) x(i, j) = i * 10.0f + j;
+        assert(!x.contiguous());
+        assert(npy_save("test-npy.npy", x));
+
+        {
+            NpyFile f = NpyFile::open("test-npy.npy");
+            assert(f.valid() && f.info().ndim == 2 && f.info().shape[0] == 5 && f.info().shape[1] == 7);
+            assert(f.info().data_offset % 64 == 0);
+            Tensor<f32, 2> v = f.view<f32, 2>();
+            assert(v.contiguous() && v.dim<0>() == 5 && v.dim<1>() == 7);
+            for (u32 i = 0; i < 5; ++i) for (u32 j = 0; j < 7; ++j) assert(v(i, j) == x(i, j));
+            v(1, 1) = -1;
+            assert((f.view<f32, 2>()(1, 1) == -1));
+
+            assert(!status_of([&] { return f.view<f64, 2>(); }).ok());
+            assert(!status_of([&] { return f.view<f32, 1>(); }).ok());
+        }
+        assert((NpyFile::open("test-npy.npy").view<f32, 2>()(1, 1) == 11));
+        std::remove("test-npy.npy");
+
+        alignas(64) u8 buf[128] = { 0x93, 'N', 'U', 'M', 'P', 'Y', 1, 0, 118, 0 };
+        const char dict[] = "{'descr': '<i2', 'fortran_order': False, 'shape': (5,), }";
+        std::memcpy(buf + 10, dict, sizeof(dict) - 1);
+        for (u32 i = 10 + sizeof(dict) - 1; i < 127; ++i) buf[i] = ' ';
+        buf[127] = '\n';
+        u8 file[128 + 10];
+        std::memcpy(file, buf, 128);
+        for (u32 i = 0; i < 5; ++i) file[128 + 2 * i] = (u8)(i * 3), file[129 + 2 * i] = 0;
+        NpyFile f = NpyFile::from_buffer(file, sizeof(file));
+        assert(std::strcmp(f.info().descr, "<i2") == 0 && !f.info().fortran_order && f.info().data_offset == 128);
+        Tensor<i16, 1> v = f.view<i16, 1>();
+        assert(v.dim<0>() == 5 && &v(0) == reinterpret_cast<i16*>(file + 128));
+        for (u32 i = 0; i < 5; ++i) assert(v(i) == (i16)(i * 3));
+
+        NpyHeader h;
+        assert(!parse_npy_header(file, 9, h));
+        file[6] = 9;
+        assert(!parse_npy_header(file, sizeof(file), h));
+    } CATCH({
+        std::cout << "!!!! npy error: " << x.what() << '\n';
+        throw;
+    })
+
     TRY { // filter
         #define check_filter() { for (int i = 0; i < 3; ++i) { for (int j = 0; j < 2; ++j) { assert(std::abs(f.inspect_means()[i][j] - means[i][j]) < 0.0001); } assert(std::abs(f.inspect_weights()[i] - weights[i]) < 0.0001); } }
 
@@ -1329,5 +2082,59 @@ int main() {
         throw;
     })
 
+    TRY { // dsp
+        // the emulations follow the hardware: saturating where it saturates, wrapping where it wraps
+        assert(ssat<16>(40000) == 32767 && ssat<16>(-40000) == -32768 && ssat<8>(-5) == -5);
+        assert(qadd(INT32_MAX, 1) == INT32_MAX && qadd(INT32_MIN, -1) == INT32_MIN && qadd(3, -5) == -2);
+        assert(qadd16(pack16(32767, -32768), pack16(1, -1)) == pack16(32767, -32768));
+        assert(qsub16(pack16(-32768, 5), pack16(1, 7)) == pack16(-32768, -2));
+        assert(smuad(pack16(3, -4), pack16(5, 6)) == 3 * 5 - 4 * 6);
+        assert(smlad(pack16(-32768, -32768), pack16(-32768, -32768), 0) == INT32_MIN); // 2^31 wraps
+        assert(smlald(pack16(-32768, -32768), pack16(-32768, -32768), 0) == (i64)1 << 31);
+        assert(to_q15(1.0f) == 32767 && to_q15(-1.0f) == -32768 && to_q15(0.5f) == 16384);
+
+        // the kernels against the float reference
+        const u32 n = 37;
+        f32 a[n], b[n];
+        i16 qa[n], qb[n];
+        for (u32 i = 0; i < n; ++i) {
+            a[i] = std::sin(i * 0.7f) * 0.9f;
+            b[i] = std::cos(i * 0.3f) * 0.6f;
+        }
+        to_q15(qa, a, n);
+        to_q15(qb, b, n);
+        f64 dot = 0, dist = 0, exact = 0;
+        for (u32 i = 0; i < n; ++i) {
+            dot += (f64)a[i] * b[i];
+            dist += ((f64)a[i] - b[i]) * ((f64)a[i] - b[i]);
+            exact += ((i64)qa[i] - qb[i]) * ((i64)qa[i] - qb[i]);
+        }
+        assert(std::abs(dot_q15(qa, qb, n) / 1073741824.0 - dot) < 1e-3);
+        assert(l2_dist_sqr_q15(qa, qb, n) == (i64)exact && std::abs(exact / 1073741824.0 - dist) < 1e-3);
+
+        i16 window[n], windowed[n];
+        f32 reference[n];
+        hann_window_q15(window, n);
+        window_q15_into(windowed, qa, window, n);
+        hann_window_into(reference, a, n);
+        for (u32 i = 0; i < n; ++i) assert(std::abs(from_q15(windowed[i]) - reference[i]) < 1e-4f);
+
+        // q15 embeddings cluster the same way as floats
+        Filter<f32, 3, 2> ff { 0.25f, 5 };
+        Filter<i16, 3, 2> fq { to_q15(0.25f), 5 };
+        const f32 points[][2] = { { 0.1f, 0.2f }, { -0.3f, 0.2f }, { -0.32f, 0.21f }, { -0.4f, 0.1f }, { -0.34f, 0.22f } };
+        for (const auto &p : points) {
+            const i16 q[2] = { to_q15(p[0]), to_q15(p[1]) };
+            assert(ff.insert(p) == fq.insert(q));
+        }
+        for (u32 i = 0; i < 3; ++i) {
+            assert(ff.inspect_weights()[i] == fq.inspect_weights()[i]);
+            for (u32 j = 0; j < 2; ++j) assert(std::abs(ff.inspect_means()[i][j] - from_q15(fq.inspect_means()[i][j])) < 1e-3f);
+        }
+    } CATCH({
+        std::cout << "!!!! dsp error: " << x.what() << '\n';
+        throw;
+    })
+
     std::cout << "passed all tests! (no output means good)\n";
 }
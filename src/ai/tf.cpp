@@ -1,50 +1,758 @@
+// builds with AOT_INFERENCE link model_aot.cpp in place of this file and the interpreter
+#ifndef AOT_INFERENCE
+
+// the recording allocator breaks the persistent part of the arena down by kind for arena_report(), at the cost of
+// arena and code space, so target builds only get it on request (make RECORD_ARENA=1). host builds always have it.
+#if !defined(RECORD_ARENA) && !defined(__ARM_ARCH_7EM__)
+#define RECORD_ARENA
+#endif
+
+#include "tensorflow/lite/micro/arena_allocator/single_arena_buffer_allocator.h"
+#include "tensorflow/lite/micro/kernels/kernel_util.h"
+#include "tensorflow/lite/micro/memory_planner/greedy_memory_planner.h"
+#include "tensorflow/lite/micro/micro_context.h"
 #include "tensorflow/lite/micro/micro_interpreter.h"
 #include "tensorflow/lite/micro/micro_mutable_op_resolver.h"
+#include "tensorflow/lite/micro/micro_profiler_interface.h"
+#if defined(RECORD_ARENA)
+#include "tensorflow/lite/micro/recording_micro_allocator.h"
+#endif
+#include "tensorflow/lite/schema/schema_generated.h"
+
+#include <cstdio>
+#include <cstring>
+#if defined(__ARM_ARCH_7EM__)
+#include "../external/fatfs/ff.h"
+#else
+#include <chrono>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
+#include "./fuse.h"
+#include "./kernels.h"
 #include "./model.h"
+#include "./pool.h"
 #include "./tensor.h"
+#include "./tf.h"
 
-constexpr u32 tensor_arena_size = 27 * 1024;
-u8 tensor_arena[tensor_arena_size];
+// arena_size.h is written by the arena tool, which measures the build it runs in, so the check only means
+// something for host builds, and it is not checked in. the target's figure is inference_arena_used() on the target.
+#if !defined(__ARM_ARCH_7EM__) && __has_include("./arena_size.h")
+#include "./arena_size.h"
+static_assert(TENSOR_ARENA_SIZE >= TENSOR_ARENA_MODEL_SIZE, "tensor arena is smaller than the model needs");
+#endif
 
-Tensor<f32, 1> inference(const Tensor<f32, 2> &x) {
-    static struct Cache {
-        const tflite::Model *model;
-        tflite::MicroMutableOpResolver<7> resolver;
-        char interpreter[sizeof(tflite::MicroInterpreter)];
-        TfLiteTensor *input, *output;
-        Cache() {
-            model = tflite::GetModel(model_tflite);
-            if (model->version() != TFLITE_SCHEMA_VERSION) THROW(std::runtime_error("wrong model schema version"));
-
-            if (resolver.AddQuantize() != kTfLiteOk) THROW(std::runtime_error("failed to add quantize op to resolver"));
-            if (resolver.AddReshape() != kTfLiteOk) THROW(std::runtime_error("failed to add reshape op to resolver"));
-            if (resolver.AddConv2D() != kTfLiteOk) THROW(std::runtime_error("failed to add conv2d op to resolver"));
-            if (resolver.AddTranspose() != kTfLiteOk) THROW(std::runtime_error("failed to add transpose op to resolver"));
-            if (resolver.AddLeakyRelu() != kTfLiteOk) THROW(std::runtime_error("failed to add leaky relu op to resolver"));
-            if (resolver.AddFullyConnected() != kTfLiteOk) THROW(std::runtime_error("failed to add fully connected op to resolver"));
-            if (resolver.AddDequantize() != kTfLiteOk) THROW(std::runtime_error("failed to add dequantize op to resolver"));
-
-            new (interpreter) tflite::MicroInterpreter { model, resolver, tensor_arena, tensor_arena_size };
-            if (reinterpret_cast<tflite::MicroInterpreter*>(interpreter)->AllocateTensors() != kTfLiteOk) THROW(std::runtime_error("failed to allocate tensors"));
-
-            input = reinterpret_cast<tflite::MicroInterpreter*>(interpreter)->input(0);
-            output = reinterpret_cast<tflite::MicroInterpreter*>(interpreter)->output(0);
-
-            if (input->type != kTfLiteFloat32) THROW(std::runtime_error("model input is not f32"));
-            if (output->type != kTfLiteFloat32) THROW(std::runtime_error("model output is not f32"));
-
-            if (input->dims->size != 3 || input->dims->data[0] != 1) THROW(std::runtime_error("input wrong shape"));
-            if (output->dims->size != 2 || output->dims->data[0] != 1) THROW(std::runtime_error("output wrong shape"));
+// a model loaded at run time is set up in a standby arena while the current one keeps running in the other. on the
+// target that arena and the regions model files are read into are only reserved in HOT_SWAP builds (make HOT_SWAP=1),
+// so firmware that never loads a model doesn't pay for them; host builds always have them.
+#if !defined(HOT_SWAP) && !defined(__ARM_ARCH_7EM__)
+#define HOT_SWAP
+#endif
+#ifndef STANDBY_ARENA_SIZE
+#if defined(HOT_SWAP)
+#define STANDBY_ARENA_SIZE TENSOR_ARENA_SIZE
+#else
+#define STANDBY_ARENA_SIZE 0
+#endif
+#endif
+
+constexpr u32 tensor_arena_size = TENSOR_ARENA_SIZE, standby_arena_size = STANDBY_ARENA_SIZE;
+alignas(TENSOR_ALIGN) u8 tensor_arena[tensor_arena_size];
+#if STANDBY_ARENA_SIZE > 0
+alignas(TENSOR_ALIGN) u8 standby_arena[standby_arena_size];
+#else
+u8 *const standby_arena = nullptr;
+#endif
+
+#if defined(__ARM_ARCH_7EM__)
+// flatbuffers read from the sd card land here, one region per arena, and get fused in place. the compiled-in model
+// is copied into its region to be fused, or into a buffer of its own without regions.
+#ifndef MODEL_REGION_SIZE
+#if defined(HOT_SWAP)
+#define MODEL_REGION_SIZE (32 * 1024)
+#else
+#define MODEL_REGION_SIZE 0
+#endif
+#endif
+#if MODEL_REGION_SIZE > 0
+alignas(16) static u8 model_region[2][MODEL_REGION_SIZE];
+#else
+static u8 *const model_region[2] = { nullptr, nullptr };
+#endif
+#endif
+
+// largest piece of [lo, hi) that doesn't intersect either of the used ranges
+static ArenaScratch largest_gap(u8 *lo, u8 *hi, u8 *a_begin, u8 *a_end, u8 *b_begin, u8 *b_end) {
+    if (b_begin < a_begin) {
+        std::swap(a_begin, b_begin);
+        std::swap(a_end, b_end);
+    }
+    u8 *const bounds[3][2] = { { lo, a_begin }, { a_end, b_begin }, { b_end, hi } };
+
+    ArenaScratch res = { nullptr, 0 };
+    for (const auto &b : bounds) {
+        u8 *begin = std::max(b[0], lo), *end = std::min(b[1], hi);
+        begin = reinterpret_cast<u8*>((reinterpret_cast<uintptr_t>(begin) + TENSOR_ALIGN - 1) & ~(uintptr_t)(TENSOR_ALIGN - 1));
+        if (end > begin && (u32)(end - begin) > res.size) res = { begin, (u32)(end - begin) };
+    }
+    return res;
+}
+
+#if defined(__ARM_ARCH_7EM__)
+// the dwt cycle counter, which only counts once trace is enabled in the debug block
+static volatile u32 &dwt_ctrl = *reinterpret_cast<volatile u32*>(0xe0001000);
+static volatile u32 &dwt_cyccnt = *reinterpret_cast<volatile u32*>(0xe0001004);
+static volatile u32 &demcr = *reinterpret_cast<volatile u32*>(0xe000edfc);
+static void profile_clock_start() {
+    demcr |= 1u << 24;
+    dwt_cyccnt = 0;
+    dwt_ctrl |= 1u;
+}
+static u32 profile_ticks() {
+    return dwt_cyccnt;
+}
+static const char *const profile_unit = "cycles";
+#else
+static void profile_clock_start() {}
+static u32 profile_ticks() {
+    return (u32)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+static const char *const profile_unit = "ns";
+#endif
+
+// the interpreter opens one event per op it invokes, tagged with the op name. ops are numbered in invocation
+// order, so slot i accumulates op i of every invocation while profiling is on; off, each event is a single branch.
+constexpr u32 profile_max_ops = 128;
+class OpProfiler : public tflite::MicroProfilerInterface {
+public:
+    struct Op {
+        const char *tag;
+        u32 count;
+        u64 ticks;
+    };
+    bool on = false;
+    u32 invocations = 0, ops = 0, next = 0;
+    Op timings[profile_max_ops];
+    u32 starts[profile_max_ops];
+
+    void clear() {
+        invocations = ops = next = 0;
+        std::memset(timings, 0, sizeof(timings));
+    }
+    u32 BeginEvent(const char *tag) override {
+        if (!on || next >= profile_max_ops) return profile_max_ops;
+        timings[next].tag = tag;
+        starts[next] = profile_ticks();
+        return next++;
+    }
+    void EndEvent(u32 handle) override {
+        if (handle >= profile_max_ops) return;
+        timings[handle].ticks += profile_ticks() - starts[handle];
+        ++timings[handle].count;
+        if (handle + 1 > ops) ops = handle + 1;
+    }
+};
+
+// the custom op fuse.h puts in place of a conv2d and its leaky relu: conv2d_leaky_q8 from kernels.h, which gives the
+// bytes of the two reference kernels back to back without writing the conv's output map in between
+struct ConvLeakyData {
+    ConvLeakyOptions options;
+    QConv2D conv;
+    QLeakyRelu leaky;
+    QMultiplier *mult;
+};
+
+static void *conv_leaky_init(TfLiteContext *context, const char *buffer, size_t length) {
+    if (!buffer || length != sizeof(ConvLeakyOptions)) return nullptr;
+    auto *data = static_cast<ConvLeakyData*>(context->AllocatePersistentBuffer(context, sizeof(ConvLeakyData)));
+    if (data) std::memcpy(&data->options, buffer, sizeof(ConvLeakyOptions));
+    return data;
+}
+
+static TfLiteStatus conv_leaky_setup(TfLiteContext *context, ConvLeakyData *data, const TfLiteTensor *input, const TfLiteTensor *filter,
+                                     const TfLiteTensor *bias, const TfLiteTensor *output) {
+    if (!data || !input || !filter || !output) return kTfLiteError;
+    if (input->type != kTfLiteInt8 || filter->type != kTfLiteInt8 || output->type != kTfLiteInt8 || (bias && bias->type != kTfLiteInt32)) return kTfLiteError;
+    if (input->dims->size != 4 || filter->dims->size != 4 || output->dims->size != 4) return kTfLiteError;
+    const auto *q = static_cast<const TfLiteAffineQuantization*>(filter->quantization.params);
+    const u32 out_c = (u32)output->dims->data[3];
+    if (filter->quantization.type != kTfLiteAffineQuantization || !q || !q->scale || (q->scale->size != 1 && q->scale->size != (int)out_c)) return kTfLiteError;
+
+    const ConvLeakyOptions &o = data->options;
+    QConv2D &p = data->conv;
+    p.in_h = (u32)input->dims->data[1], p.in_w = (u32)input->dims->data[2], p.in_c = (u32)input->dims->data[3];
+    p.out_h = (u32)output->dims->data[1], p.out_w = (u32)output->dims->data[2], p.out_c = out_c;
+    p.k_h = (u32)filter->dims->data[1], p.k_w = (u32)filter->dims->data[2];
+    p.stride_h = (u32)o.stride_h, p.stride_w = (u32)o.stride_w, p.dilation_h = (u32)o.dilation_h, p.dilation_w = (u32)o.dilation_w;
+    p.pad_h = p.pad_w = 0;
+    if (o.padding == 0) {
+        p.pad_h = (u32)std::max<i32>(0, (i32)((p.out_h - 1) * p.stride_h + (p.k_h - 1) * p.dilation_h + 1 - p.in_h) / 2);
+        p.pad_w = (u32)std::max<i32>(0, (i32)((p.out_w - 1) * p.stride_w + (p.k_w - 1) * p.dilation_w + 1 - p.in_w) / 2);
+    }
+    p.in_zero_point = input->params.zero_point;
+    p.out_zero_point = o.conv_zero_point;
+    const auto level = [&](f32 v) { return o.conv_zero_point + (i32)std::round(v / o.conv_scale); };
+    p.act_min = o.activation == 1 || o.activation == 3 ? std::max(-128, level(0.0f)) : o.activation == 2 ? std::max(-128, level(-1.0f)) : -128;
+    p.act_max = o.activation == 3 ? std::min(127, level(6.0f)) : o.activation == 2 ? std::min(127, level(1.0f)) : 127;
+
+    data->mult = static_cast<QMultiplier*>(context->AllocatePersistentBuffer(context, out_c * sizeof(QMultiplier)));
+    if (!data->mult) return kTfLiteError;
+    for (u32 c = 0; c < out_c; ++c) data->mult[c] = quantize_multiplier((f64)input->params.scale * (f64)q->scale->data[q->scale->size == 1 ? 0 : c] / (f64)o.conv_scale);
+    data->leaky = { o.conv_zero_point, o.out_zero_point, quantize_multiplier((f64)(o.conv_scale / o.out_scale)), quantize_multiplier((f64)(o.conv_scale * o.alpha / o.out_scale)) };
+    return kTfLiteOk;
+}
+
+static TfLiteStatus conv_leaky_prepare(TfLiteContext *context, TfLiteNode *node) {
+    if (node->inputs->size < 2 || node->outputs->size != 1) return kTfLiteError;
+    tflite::MicroContext *micro = tflite::GetMicroContext(context);
+    TfLiteTensor *input = micro->AllocateTempInputTensor(node, 0), *filter = micro->AllocateTempInputTensor(node, 1);
+    TfLiteTensor *bias = node->inputs->size > 2 ? micro->AllocateTempInputTensor(node, 2) : nullptr, *output = micro->AllocateTempOutputTensor(node, 0);
+    const TfLiteStatus status = conv_leaky_setup(context, static_cast<ConvLeakyData*>(node->user_data), input, filter, bias, output);
+    for (TfLiteTensor *t : { input, filter, bias, output }) if (t) micro->DeallocateTempTfLiteTensor(t);
+    return status;
+}
+
+static TfLiteStatus conv_leaky_invoke(TfLiteContext *context, TfLiteNode *node) {
+    const auto *data = static_cast<const ConvLeakyData*>(node->user_data);
+    const TfLiteEvalTensor *input = tflite::micro::GetEvalInput(context, node, 0), *filter = tflite::micro::GetEvalInput(context, node, 1);
+    const TfLiteEvalTensor *bias = node->inputs->size > 2 ? tflite::micro::GetEvalInput(context, node, 2) : nullptr;
+    TfLiteEvalTensor *output = tflite::micro::GetEvalOutput(context, node, 0);
+    conv2d_leaky_q8(tflite::micro::GetTensorData<int8_t>(output), tflite::micro::GetTensorData<int8_t>(input), tflite::micro::GetTensorData<int8_t>(filter),
+                    bias ? tflite::micro::GetTensorData<int32_t>(bias) : nullptr, data->mult, data->conv, data->leaky);
+    return kTfLiteOk;
+}
+
+static TFLMRegistration conv_leaky_registration = tflite::micro::RegisterOp(conv_leaky_init, conv_leaky_prepare, conv_leaky_invoke);
+
+// throws, or in NO_EXCEPTIONS builds latches the error and hands it back as the Status of the failing call
+#define FAIL(msg) do { THROW(std::runtime_error, msg); return take_error(); } while (0)
+
+// the fused copy of a flatbuffer stays in ram for as long as the session runs it (25656 bytes for the bundled model),
+// and the unfused one is read from flash in place. the target only pays for that by default in sessions with a model
+// region reserved for it, which only HOT_SWAP builds have.
+#if defined(__ARM_ARCH_7EM__)
+constexpr bool fuse_by_default = false;
+#else
+constexpr bool fuse_by_default = true;
+#endif
+
+// one model set up in one arena
+struct InferenceSession::State {
+    const tflite::Model *model;
+    tflite::MicroMutableOpResolver<8> resolver;
+    char interpreter[sizeof(tflite::MicroInterpreter)];
+    bool live, ops_added;
+    u8 *arena;
+    u32 arena_size;
+    void *mapping;  // mmapped file backing the model, if any
+    u32 mapping_size;
+    bool fuse;
+    u8 *region;  // where the model is fused: a reserved region, or else a buffer of the session's own
+    u32 region_size;
+    u8 *owned;
+    u32 owned_size;
+#if defined(RECORD_ARENA)
+    tflite::RecordingMicroAllocator *allocator;
+#else
+    tflite::MicroAllocator *allocator;
+#endif
+    const tflite::SingleArenaBufferAllocator *buffers;  // the arena under allocator
+    OpProfiler profiler;
+    TfLiteTensor *input, *output;
+    ArenaScratch scratch;
+    Status status;
+    State(u8 *_arena, u32 _arena_size, u8 *_region = nullptr, u32 _region_size = 0) : model{nullptr}, live{false}, ops_added{false}, arena{_arena},
+        arena_size{_arena_size}, mapping{nullptr}, mapping_size{0}, fuse{fuse_by_default || _region}, region{_region}, region_size{_region_size}, owned{nullptr}, owned_size{0},
+        allocator{nullptr}, buffers{nullptr}, input{nullptr}, output{nullptr}, scratch{nullptr, 0}, status{"no model loaded"} {}
+    ~State() {
+        release();
+        aligned_delete(owned);
+    }
+
+    tflite::MicroInterpreter *get() { return reinterpret_cast<tflite::MicroInterpreter*>(interpreter); }
+    const tflite::MicroInterpreter *get() const { return reinterpret_cast<const tflite::MicroInterpreter*>(interpreter); }
+
+    // drops the interpreter and whatever backs the flatbuffer, leaving the session empty
+    void release() {
+        if (live) get()->~MicroInterpreter();
+        live = false;
+#if !defined(__ARM_ARCH_7EM__)
+        if (mapping) munmap(mapping, mapping_size);
+#endif
+        mapping = nullptr;
+        mapping_size = 0;
+        input = output = nullptr;
+        scratch = { nullptr, 0 };
+        status = Status{ "no model loaded" };
+    }
+
+    Status add_ops() {
+        if (ops_added) return Status{ nullptr };
+        if (resolver.AddQuantize() != kTfLiteOk) FAIL("failed to add quantize op to resolver");
+        if (resolver.AddReshape() != kTfLiteOk) FAIL("failed to add reshape op to resolver");
+        if (resolver.AddConv2D() != kTfLiteOk) FAIL("failed to add conv2d op to resolver");
+        if (resolver.AddTranspose() != kTfLiteOk) FAIL("failed to add transpose op to resolver");
+        if (resolver.AddLeakyRelu() != kTfLiteOk) FAIL("failed to add leaky relu op to resolver");
+        if (resolver.AddFullyConnected() != kTfLiteOk) FAIL("failed to add fully connected op to resolver");
+        if (resolver.AddDequantize() != kTfLiteOk) FAIL("failed to add dequantize op to resolver");
+        if (resolver.AddCustom(CONV_LEAKY_OP, &conv_leaky_registration) != kTfLiteOk) FAIL("failed to add fused conv op to resolver");
+        ops_added = true;
+        return Status{ nullptr };
+    }
+
+    // the verified model with its conv2d + leaky relu groups fused (fuse.h), or the model as it is if nothing fuses,
+    // there's no room to fuse it or the result doesn't verify
+    const u8 *fused(const u8 *data, u32 len) {
+        const u32 size = fuse ? conv_leaky_fused_size(data, len) : len;
+        if (size == len) return data;
+        u8 *buf = region && size <= region_size ? region : nullptr;
+        if (!buf) {
+            if (size > owned_size) {
+                aligned_delete(owned);
+                owned = aligned_new<u8>(size, 16);
+                owned_size = owned ? size : 0;
+            }
+            buf = owned;
+        }
+        if (!buf) return data;
+        std::memmove(buf, data, len);
+        const u32 fused_len = fuse_conv_leaky(buf, len, size);
+        // the rewrite goes in front of the original, which is still whole behind it
+        flatbuffers::Verifier verifier(buf, fused_len);
+        return tflite::VerifyModelBuffer(verifier) ? buf : buf + (fused_len - len);
+    }
+
+    // a fresh allocator over the whole arena and an interpreter on it for model. with a fallback to try, a model whose
+    // tensors don't allocate fails quietly.
+    Status start(bool fallback) {
+        if (live) get()->~MicroInterpreter();
+        live = false;
+#if defined(RECORD_ARENA)
+        allocator = tflite::RecordingMicroAllocator::Create(arena, arena_size);
+        if (!allocator) FAIL("failed to create arena allocator");
+        buffers = allocator->GetSimpleMemoryAllocator();
+#else
+        // what MicroAllocator::Create(arena, size) does, keeping hold of the arena allocator for the scratch below
+        tflite::SingleArenaBufferAllocator *arena_buffers = tflite::SingleArenaBufferAllocator::Create(arena, arena_size);
+        void *planner = arena_buffers ? arena_buffers->AllocatePersistentBuffer(sizeof(tflite::GreedyMemoryPlanner), alignof(tflite::GreedyMemoryPlanner)) : nullptr;
+        allocator = planner ? tflite::MicroAllocator::Create(arena_buffers, new (planner) tflite::GreedyMemoryPlanner()) : nullptr;
+        if (!allocator) FAIL("failed to create arena allocator");
+        buffers = arena_buffers;
+#endif
+        new (interpreter) tflite::MicroInterpreter { model, resolver, allocator, nullptr, &profiler };
+        live = true;
+        if (get()->AllocateTensors() != kTfLiteOk) {
+            if (fallback) return Status{ "failed to allocate tensors" };
+            FAIL("failed to allocate tensors");
+        }
+        return Status{ nullptr };
+    }
+
+    // data must stay valid until the session is released or set up again
+    Status setup(const u8 *data, u32 len) {
+        if (!arena) FAIL("session has no arena");
+        if (live) get()->~MicroInterpreter();
+        live = false;
+        input = output = nullptr;
+        scratch = { nullptr, 0 };
+
+        flatbuffers::Verifier verifier(data, len);
+        if (!tflite::VerifyModelBuffer(verifier)) FAIL("model is not a valid tflite flatbuffer");
+        model = tflite::GetModel(data);
+        if (model->version() != TFLITE_SCHEMA_VERSION) FAIL("wrong model schema version");
+        if (!model->subgraphs() || model->subgraphs()->size() != 1) FAIL("model must have exactly one subgraph");
+        const tflite::Model *original = model;
+        model = tflite::GetModel(fused(data, len));
+
+        const Status ops = add_ops();
+        if (!ops.ok()) return ops;
+
+        // tflm can still refuse to plan the rewritten model, and then the original gets its turn
+        Status started = start(model != original);
+        if (!started.ok() && model != original) {
+            model = original;
+            started = start(false);
+        }
+        if (!started.ok()) return started;
+
+        input = get()->input(0);
+        output = get()->output(0);
+
+        if (input->type != kTfLiteFloat32 && input->type != kTfLiteInt8) FAIL("model input is not f32 or int8");
+        if (output->type != kTfLiteFloat32) FAIL("model output is not f32");
+
+        if (input->dims->size != 3 || input->dims->data[0] != 1) FAIL("input wrong shape");
+        if (output->dims->size != 2 || output->dims->data[0] != 1) FAIL("output wrong shape");
+
+        // planned buffers grow up from the start of the arena and persistent ones down from the end
+        const u32 persistent = (u32)buffers->GetPersistentUsedBytes();
+        u8 *in = reinterpret_cast<u8*>(input->data.raw), *out = reinterpret_cast<u8*>(output->data.raw);
+        scratch = largest_gap(arena, arena + arena_size - persistent, in, in + input->bytes, out, out + output->bytes);
+        return Status{ nullptr };
+    }
+
+    Status setup_file(const char *path, u8 *buffer, u32 buffer_size) {
+        release();
+#if defined(__ARM_ARCH_7EM__)
+        // the volume has to be mounted already
+        static FIL file;
+        UINT read = 0;
+        if (!buffer) FAIL("no buffer to read the model file into");
+        if (f_open(&file, path, FA_READ) != FR_OK) FAIL("failed to open model file");
+        const FSIZE_t size = f_size(&file);
+        const bool ok = size <= buffer_size && f_read(&file, buffer, (UINT)size, &read) == FR_OK && read == size;
+        f_close(&file);
+        if (size > buffer_size) FAIL("model file is larger than its buffer");
+        if (!ok) FAIL("failed to read model file");
+        const u8 *data = buffer;
+#else
+        (void)buffer;
+        (void)buffer_size;
+        const int fd = open(path, O_RDONLY);
+        if (fd < 0) FAIL("failed to open model file");
+        struct stat st;
+        const bool sized = fstat(fd, &st) == 0 && st.st_size > 0;
+        void *map = sized ? mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+        close(fd);
+        if (map == MAP_FAILED) FAIL("failed to map model file");
+        mapping = map;
+        mapping_size = (u32)st.st_size;
+        const u8 *data = reinterpret_cast<const u8*>(map);
+        const u32 size = mapping_size;
+#endif
+        return setup(data, (u32)size);
+    }
+};
+
+InferenceSession::InferenceSession(State *external) : state{external}, owns_state{false}, owned_arena{nullptr} {}
+
+InferenceSession::InferenceSession(u8 *arena, u32 arena_size) : state{new State(arena, arena_size)}, owns_state{true}, owned_arena{nullptr} {}
+
+InferenceSession::InferenceSession(u32 arena_size) : state{nullptr}, owns_state{true}, owned_arena{aligned_new<u8>(arena_size)} {
+    state = new State(owned_arena, owned_arena ? arena_size : 0);
+}
+
+InferenceSession::~InferenceSession() {
+    if (owns_state) delete state;
+    aligned_delete(owned_arena);
+}
+
+Status InferenceSession::load(const u8 *model, u32 len) {
+    state->release();
+    state->status = state->setup(model, len);
+    return state->status;
+}
+
+Status InferenceSession::load_file(const char *path, u8 *buffer, u32 buffer_size) {
+    state->status = state->setup_file(path, buffer, buffer_size);
+    return state->status;
+}
+
+void InferenceSession::fuse(bool on) {
+    state->fuse = on;
+}
+
+u32 InferenceSession::ops() const {
+    return state->status.ok() ? state->model->subgraphs()->Get(0)->operators()->size() : 0;
+}
+
+Status InferenceSession::status() const {
+    return state->status;
+}
+
+ArenaScratch InferenceSession::scratch() const {
+    return state->scratch;
+}
+
+u32 InferenceSession::output_size() const {
+    return state->status.ok() ? state->output->dims->data[1] : 0;
+}
+
+Tensor<f32, 2> InferenceSession::input() {
+    if (!state->status.ok() || state->input->type != kTfLiteFloat32) return {};
+    return { state->input->data.f, nullptr, state->input->dims->data[1], state->input->dims->data[2] };
+}
+
+QTensor<i8, 2> InferenceSession::input_q8() {
+    if (!state->status.ok() || state->input->type != kTfLiteInt8) return {};
+    const QParams params = { state->input->params.scale, state->input->params.zero_point };
+    return { Tensor<i8, 2> { state->input->data.int8, nullptr, state->input->dims->data[1], state->input->dims->data[2] }, params };
+}
+
+Tensor<f32, 1> InferenceSession::output() {
+    if (!state->status.ok()) return {};
+    return { state->output->data.f, nullptr, state->output->dims->data[1] };
+}
+
+Status InferenceSession::invoke() {
+    if (!state->status.ok()) return state->status;
+
+    state->profiler.next = 0;
+    if (state->get()->Invoke() != kTfLiteOk) FAIL("failed to execute model");
+    if (state->profiler.on) ++state->profiler.invocations;
+    return Status{ nullptr };
+}
+
+Status InferenceSession::run_into(Tensor<f32, 1> &res, const Tensor<f32, 2> &x) {
+    if (!state->status.ok()) return state->status;
+
+    const TfLiteTensor *in = state->input, *out = state->output;
+    if (in->dims->data[1] != (int)x.dim<0>() || in->dims->data[2] != (int)x.dim<1>()) FAIL("input wrong shape");
+    if (out->dims->data[1] != (int)res.dim<0>()) FAIL("output wrong shape");
+    if (in->type == kTfLiteInt8) {
+        QTensor<i8, 2> q = input_q8();
+        quantize_into(q, x);
+    } else {
+        for (u32 i = 0; i < x.dim<0>() && x.row(0) != in->data.f; ++i) {
+            const f32 *row = x.row(i);
+            for (u32 j = 0; j < x.dim<1>(); ++j) in->data.f[i * x.dim<1>() + j] = row[j];
         }
-    } cache;
+    }
 
-    if (cache.input->dims->data[1] != x.dim<0>() || cache.input->dims->data[2] != x.dim<1>()) THROW(std::runtime_error("input wrong shape"));
-    for (u32 i = x.size(); i-- > 0; ) cache.input->data.f[i] = (&x(0,0))[i];
+    const Status status = invoke();
+    if (!status.ok()) return status;
 
-    if (reinterpret_cast<tflite::MicroInterpreter*>(cache.interpreter)->Invoke() != kTfLiteOk) THROW(std::runtime_error("failed to execute model"));
+    for (u32 i = 0; i < res.dim<0>(); ++i) res(i) = out->data.f[i];
+    return Status{ nullptr };
+}
 
-    Tensor<f32, 1> res { new f32[cache.output->dims->data[1]], [](auto *p) { delete[] p; }, cache.output->dims->data[1] };
-    for (u32 i = 0; i < res.dim<0>(); ++i) res(i) = cache.output->data.f[i];
+Tensor<f32, 1> InferenceSession::run(const Tensor<f32, 2> &x) {
+    const u32 size = output_size();
+    if (size == 0) return {};
+    auto res = Tensor<f32, 1>::alloc(size);
+    if (!run_into(res, x).ok()) return {};
     return res;
 }
+
+u32 InferenceSession::arena_used() const {
+    if (!state->status.ok()) return 0;
+    const u32 used = (u32)state->get()->arena_used_bytes();
+    return (used + TENSOR_ALIGN - 1) & ~(u32)(TENSOR_ALIGN - 1);
+}
+
+static u32 tensor_type_size(tflite::TensorType type) {
+    switch (type) {
+        case tflite::TensorType_FLOAT32: case tflite::TensorType_INT32: case tflite::TensorType_UINT32: return 4;
+        case tflite::TensorType_INT16: case tflite::TensorType_UINT16: case tflite::TensorType_FLOAT16: return 2;
+        case tflite::TensorType_INT64: case tflite::TensorType_UINT64: case tflite::TensorType_FLOAT64: return 8;
+        default: return 1;
+    }
+}
+
+void InferenceSession::arena_report(void (*emit)(const char *line)) const {
+    char line[128];
+    if (!state->status.ok()) {
+        std::snprintf(line, sizeof(line), "model failed to set up: %s", state->status.error);
+        emit(line);
+        return;
+    }
+
+    const auto *arena = state->buffers;
+    const u32 persistent = (u32)arena->GetPersistentUsedBytes(), nonpersistent = (u32)arena->GetNonPersistentUsedBytes();
+    std::snprintf(line, sizeof(line), "%-32s %10lu", "arena", (unsigned long)state->arena_size);
+    emit(line);
+    std::snprintf(line, sizeof(line), "%-32s %10lu", "used (minimum arena size)", (unsigned long)arena_used());
+    emit(line);
+    std::snprintf(line, sizeof(line), "%-32s %10lu", "  persistent", (unsigned long)persistent);
+    emit(line);
+    std::snprintf(line, sizeof(line), "%-32s %10lu", "  non-persistent", (unsigned long)nonpersistent);
+    emit(line);
+    std::snprintf(line, sizeof(line), "%-32s %10lu", "borrowable scratch", (unsigned long)state->scratch.size);
+    emit(line);
+
+#if defined(RECORD_ARENA)
+    static const struct { tflite::RecordedAllocationType type; const char *name; } kinds[] = {
+        { tflite::RecordedAllocationType::kTfLiteEvalTensorData, "eval tensors" },
+        { tflite::RecordedAllocationType::kPersistentTfLiteTensorData, "persistent tensors" },
+        { tflite::RecordedAllocationType::kPersistentTfLiteTensorQuantizationData, "quantization data" },
+        { tflite::RecordedAllocationType::kPersistentBufferData, "persistent buffers" },
+        { tflite::RecordedAllocationType::kTfLiteTensorVariableBufferData, "variable buffers" },
+        { tflite::RecordedAllocationType::kNodeAndRegistrationArray, "nodes and registrations" },
+        { tflite::RecordedAllocationType::kOpData, "op data" },
+    };
+    std::snprintf(line, sizeof(line), "%-32s %10s %10s %8s", "persistent kind", "requested", "used", "count");
+    emit(line);
+    for (const auto &k : kinds) {
+        const tflite::RecordedAllocation a = state->allocator->GetRecordedAllocation(k.type);
+        std::snprintf(line, sizeof(line), "%-32s %10lu %10lu %8lu", k.name, (unsigned long)a.requested_bytes, (unsigned long)a.used_bytes, (unsigned long)a.count);
+        emit(line);
+    }
+#else
+    emit("persistent kinds need a RECORD_ARENA build");
+#endif
+
+    // tensors with data in the flatbuffer are weights and never touch the arena; the rest are planned into its head
+    const auto *tensors = state->model->subgraphs()->Get(0)->tensors();
+    const auto *buffers = state->model->buffers();
+    std::snprintf(line, sizeof(line), "%-4s %-48s %10s %6s", "#", "tensor", "bytes", "where");
+    emit(line);
+    for (u32 i = 0; i < tensors->size(); ++i) {
+        const tflite::Tensor *t = tensors->Get(i);
+        u32 bytes = tensor_type_size(t->type());
+        if (t->shape()) for (u32 j = 0; j < t->shape()->size(); ++j) bytes *= (u32)t->shape()->Get(j);
+        const auto *buffer = t->buffer() < buffers->size() ? buffers->Get(t->buffer()) : nullptr;
+        const bool weight = buffer && buffer->data() && buffer->data()->size() > 0;
+        std::snprintf(line, sizeof(line), "%-4lu %-48.48s %10lu %6s", (unsigned long)i, t->name() ? t->name()->c_str() : "", (unsigned long)bytes, weight ? "flash" : "arena");
+        emit(line);
+    }
+}
+
+void InferenceSession::profile(bool on) {
+    OpProfiler &profiler = state->profiler;
+    if (on) {
+        profiler.clear();
+        profile_clock_start();
+    }
+    profiler.on = on;
+}
+
+void InferenceSession::profile_report(void (*emit)(const char *line)) const {
+    char line[128];
+    const OpProfiler &profiler = state->profiler;
+    const u32 n = profiler.invocations ? profiler.invocations : 1;
+    u64 total = 0;
+    for (u32 i = 0; i < profiler.ops; ++i) total += profiler.timings[i].ticks;
+    const f64 scale = total ? 100.0 / (f64)total : 0.0;
+
+    std::snprintf(line, sizeof(line), "%-4s %-20s %14s %7s   (%s per invocation, %lu invocations)", "#", "op", "mean", "share", profile_unit, (unsigned long)profiler.invocations);
+    emit(line);
+    for (u32 i = 0; i < profiler.ops; ++i) {
+        const OpProfiler::Op &op = profiler.timings[i];
+        std::snprintf(line, sizeof(line), "%-4lu %-20.20s %14lu %6.1f%%", (unsigned long)i, op.tag ? op.tag : "?", (unsigned long)(op.ticks / n), op.ticks * scale);
+        emit(line);
+    }
+
+    // the same times summed over every op of a kind
+    std::snprintf(line, sizeof(line), "%-25s %14s %7s %6s", "op type", "mean", "share", "ops");
+    emit(line);
+    bool done[profile_max_ops] = {};
+    for (u32 i = 0; i < profiler.ops; ++i) {
+        if (done[i]) continue;
+        const char *tag = profiler.timings[i].tag ? profiler.timings[i].tag : "?";
+        u64 ticks = 0;
+        u32 count = 0;
+        for (u32 j = i; j < profiler.ops; ++j) {
+            const char *other = profiler.timings[j].tag ? profiler.timings[j].tag : "?";
+            if (done[j] || std::strcmp(tag, other) != 0) continue;
+            done[j] = true;
+            ticks += profiler.timings[j].ticks;
+            ++count;
+        }
+        std::snprintf(line, sizeof(line), "%-25.25s %14lu %6.1f%% %6lu", tag, (unsigned long)(ticks / n), ticks * scale, (unsigned long)count);
+        emit(line);
+    }
+    std::snprintf(line, sizeof(line), "%-25s %14lu", "total", (unsigned long)(total / n));
+    emit(line);
+}
+
+// the default sessions behind the inference_* functions, two of them with their own arena. inference runs on the
+// active one; a model loaded at run time is set up in the other, and swapping just flips which one is active, so
+// nothing stops serving while a model loads. the previous model stays in standby until the next load, so swapping
+// again rolls back.
+struct InferenceEngine {
+    InferenceSession::State states[2];
+    InferenceSession slots[2];
+    u32 active, generation;
+#if defined(__ARM_ARCH_7EM__)
+    InferenceEngine() : states{ { tensor_arena, tensor_arena_size, model_region[0], MODEL_REGION_SIZE }, { standby_arena, standby_arena_size, model_region[1], MODEL_REGION_SIZE } },
+#else
+    InferenceEngine() : states{ { tensor_arena, tensor_arena_size }, { standby_arena, standby_arena_size } },
+#endif
+        slots{ InferenceSession(&states[0]), InferenceSession(&states[1]) }, active{0}, generation{0} {
+        slots[0].load(model_tflite, model_tflite_len);
+    }
+};
+
+static InferenceEngine &engine() {
+    static InferenceEngine engine;
+    return engine;
+}
+static InferenceSession &active() {
+    InferenceEngine &e = engine();
+    return e.slots[e.active];
+}
+
+Status inference_load(const u8 *data, u32 len) {
+    InferenceEngine &e = engine();
+    if (standby_arena_size == 0) FAIL("no standby arena to load models into (build with HOT_SWAP)");
+    return e.slots[e.active ^ 1].load(data, len);
+}
+
+Status inference_load_file(const char *path) {
+    InferenceEngine &e = engine();
+    if (standby_arena_size == 0) FAIL("no standby arena to load models into (build with HOT_SWAP)");
+#if defined(__ARM_ARCH_7EM__)
+    if (MODEL_REGION_SIZE == 0) FAIL("no region to read model files into (build with HOT_SWAP)");
+    return e.slots[e.active ^ 1].load_file(path, model_region[e.active ^ 1], MODEL_REGION_SIZE);
+#else
+    return e.slots[e.active ^ 1].load_file(path);
+#endif
+}
+
+Status inference_swap() {
+    InferenceEngine &e = engine();
+    if (!e.slots[e.active ^ 1].status().ok()) FAIL("no model loaded to swap in");
+    e.active ^= 1;
+    ++e.generation;
+    return Status{ nullptr };
+}
+
+u32 inference_generation() {
+    return engine().generation;
+}
+
+ArenaScratch inference_scratch() {
+    return active().scratch();
+}
+
+u32 inference_output_size() {
+    return active().output_size();
+}
+
+u32 inference_arena_used() {
+    return active().arena_used();
+}
+
+void inference_arena_report(void (*emit)(const char *line)) {
+    active().arena_report(emit);
+}
+
+void inference_profile(bool on) {
+    active().profile(on);
+}
+
+void inference_profile_report(void (*emit)(const char *line)) {
+    active().profile_report(emit);
+}
+
+Tensor<f32, 2> inference_input() {
+    return active().input();
+}
+
+QTensor<i8, 2> inference_input_q8() {
+    return active().input_q8();
+}
+
+Tensor<f32, 1> inference_output() {
+    return active().output();
+}
+
+Status inference_invoke() {
+    StageScope stage(STAGE_INFERENCE);
+    return active().invoke();
+}
+
+Status inference_into(Tensor<f32, 1> &res, const Tensor<f32, 2> &x) {
+    StageScope stage(STAGE_INFERENCE);
+    return active().run_into(res, x);
+}
+
+Tensor<f32, 1> inference(const Tensor<f32, 2> &x) {
+    StageScope stage(STAGE_INFERENCE);
+    return active().run(x);
+}
+
+#endif
@@ -2,7 +2,140 @@
 #define A3EM_AI_TF_H
 
 #include "./tensor.h"
+#include "./quant.h"
 
+// the 27 KB the model runs in plus the 46848 byte frontend plan for 8 kHz, 1 s clips (what main.c sets up), so the
+// frontend borrows the arena's idle part instead of getting a buffer of its own. the arena tool prints the size for
+// other clip shapes; a smaller arena still works, with the frontend taking its own buffer once.
+#ifndef TENSOR_ARENA_SIZE
+#define TENSOR_ARENA_SIZE (27 * 1024 + 46848)
+#endif
+
+// inference() returns an empty tensor and inference_output_size() returns 0 if the model failed to set up
 Tensor<f32, 1> inference(const Tensor<f32, 2> &input);
+u32 inference_output_size();
+// same as inference() but writes the embedding into res, so it never allocates
+Status inference_into(Tensor<f32, 1> &res, const Tensor<f32, 2> &input);
+
+// convenience wrapper that calls inference_into() on each clip of a [batch, rows, cols] feature tensor, the embedding
+// of clip b going to row b of res. nothing is shared between clips beyond what inference_into() already keeps, so a
+// batch costs the same per clip as single calls; tflm models are batch 1 and there is no batched kernel underneath.
+inline Status inference_batch_into(Tensor<f32, 2> &res, const Tensor<f32, 3> &x) {
+    if (res.dim<0>() != x.dim<0>()) {
+        THROW(std::runtime_error, "batch sizes differ");
+        return take_error();
+    }
+    const u32 rows = x.dim<1>(), cols = x.dim<2>();
+    for (u32 b = 0; b < x.dim<0>(); ++b) {
+        const Tensor<f32, 2> clip = Tensor<f32, 2>::strided(const_cast<f32*>(x.row(b * rows)), nullptr, x.stride(), rows, cols);
+        Tensor<f32, 1> embedding { res.row(b), nullptr, res.dim<1>() };
+        const Status status = inference_into(embedding, clip);
+        if (!status.ok()) return status;
+    }
+    return Status{ nullptr };
+}
+inline Tensor<f32, 2> inference_batch(const Tensor<f32, 3> &x) {
+    const u32 size = inference_output_size();
+    if (size == 0) return {};
+    auto res = Tensor<f32, 2>::alloc(x.dim<0>(), size);
+    if (!inference_batch_into(res, x).ok()) return {};
+    return res;
+}
+
+// views of the model's own input and output tensors (empty if the model failed to set up). writing the features
+// into inference_input() and calling inference_invoke() skips both copies; inference_output() holds the embedding
+// until the next invocation.
+Tensor<f32, 2> inference_input();
+Tensor<f32, 1> inference_output();
+Status inference_invoke();
+// for models that take int8 input (no quantize op) the input view is this one instead, with the model's input
+// params, and inference_input() is empty. f32 models leave this one empty. inference_into() handles both.
+QTensor<i8, 2> inference_input_q8();
+
+// the part of the tensor arena that only holds data while the model runs. it never overlaps the model
+// input or output, so callers may borrow it between invocations; its contents are clobbered by inference().
+struct ArenaScratch {
+    u8 *data;
+    u32 size;
+};
+ArenaScratch inference_scratch();
+
+// one model with its own interpreter in its own arena (interpreter builds only). sessions share no state, so several
+// can run side by side: two different models, or one session per host thread. the arena is either the caller's,
+// which has to outlive the session, or allocated by it. a session starts empty; load() verifies a flatbuffer and
+// sets it up, after which the calls mirror the inference_* functions, which run on a default session. sessions
+// don't mark the pool's inference stage, since they may run on other threads; the inference_* functions do. the
+// pools aren't thread safe, so construct and load sessions on one thread; invoke() and run_into() never allocate.
+class InferenceSession {
+private:
+
+    struct State;
+    State *state;
+    bool owns_state;
+    u8 *owned_arena;
+
+    friend struct InferenceEngine;
+    explicit InferenceSession(State *external);
+
+public:
+
+    explicit InferenceSession(u32 arena_size = TENSOR_ARENA_SIZE);
+    InferenceSession(u8 *arena, u32 arena_size);
+    ~InferenceSession();
+
+    InferenceSession(const InferenceSession &other) = delete;
+    InferenceSession &operator=(const InferenceSession &other) = delete;
+
+    // model has to stay valid until the next load. load_file() maps the file on the host; on the target it reads
+    // it into buffer through fatfs. a failed load leaves the session empty.
+    Status load(const u8 *model, u32 len);
+    Status load_file(const char *path, u8 *buffer = nullptr, u32 buffer_size = 0);
+    Status status() const;
+    // loads rewrite each conv2d and the leaky relu after it into one custom op (see fuse.h) when this is on; the
+    // output is the same bytes either way, and a fused model tflm won't allocate is loaded unfused. the fused copy
+    // holds the whole flatbuffer in ram for the life of the session (about 25 KB for the bundled model), in a buffer
+    // the session allocates or the reserved model region of the default sessions in HOT_SWAP builds. so it is on by
+    // default on the host and, on the target, only for sessions with such a region. ops() counts the ops as loaded.
+    void fuse(bool on);
+    u32 ops() const;
+
+    Tensor<f32, 2> input();
+    QTensor<i8, 2> input_q8();
+    Tensor<f32, 1> output();
+    u32 output_size() const;
+    Status invoke();
+    Status run_into(Tensor<f32, 1> &res, const Tensor<f32, 2> &x);
+    Tensor<f32, 1> run(const Tensor<f32, 2> &x);
+
+    ArenaScratch scratch() const;
+    u32 arena_used() const;
+    void arena_report(void (*emit)(const char *line)) const;
+    void profile(bool on);
+    void profile_report(void (*emit)(const char *line)) const;
+};
+
+// interpreter builds only. the model starts out as the compiled-in model_tflite; inference_load() and
+// inference_load_file() (mmapped on the host, read through fatfs into a reserved region on the target, whose volume
+// must be mounted) verify a flatbuffer and set it up in a standby arena while the current model keeps serving.
+// inference_swap() then makes it current between clips and bumps inference_generation(), after which views, output
+// and scratch taken from the old model are stale. a failed load leaves the current model untouched. data passed to
+// inference_load() must stay valid until the next load. target builds only reserve the standby arena and file
+// regions with HOT_SWAP defined; without it both loads fail.
+Status inference_load(const u8 *model, u32 len);
+Status inference_load_file(const char *path);
+Status inference_swap();
+u32 inference_generation();
+
+// interpreter builds only. the bytes of the arena the model actually took (rounded up to the arena alignment, so an
+// arena of exactly this size works), and a breakdown of them as lines of text: persistent vs non-persistent, the
+// recorded persistent allocations by kind and every tensor's size. both are 0/a single error line if setup failed.
+u32 inference_arena_used();
+void inference_arena_report(void (*emit)(const char *line));
+
+// per-op timing of every invocation while profiling is on (dwt cycles on the target, nanoseconds elsewhere).
+// turning it on clears the previous profile. the report has one line per op in invocation order, then the same
+// times summed per op type. compiled models have no per-op events, so their report is a single line.
+void inference_profile(bool on);
+void inference_profile_report(void (*emit)(const char *line));
 
 #endif
@@ -3,19 +3,43 @@
 
 #include "stdint.h"
 
+// without exceptions the first error is latched instead, and the failing call bails out early with a harmless value.
+// entry points (Encoder, inference) turn the latched error into a Status so that callers never run on garbage.
+struct Status {
+    const char *error;
+
+    bool ok() const { return error == nullptr; }
+};
+
+inline Status &pending_error() {
+    static Status status = { nullptr };
+    return status;
+}
+inline void raise_error(const char *what) {
+    if (pending_error().ok()) pending_error().error = what;
+}
+inline Status take_error() {
+    const Status res = pending_error();
+    pending_error().error = nullptr;
+    return res;
+}
+
+// THROW(type, msg) throws type(msg), or without exceptions latches msg itself
 #ifndef NO_EXCEPTIONS
-#define THROW(x) throw x
+#define THROW(type, msg) throw type(msg)
 #else
-#define THROW(X)
+#define THROW(type, msg) raise_error(msg)
 #endif
 
 typedef uint8_t u8;
 typedef uint16_t u16;
 typedef uint32_t u32;
+typedef uint64_t u64;
 
 typedef int8_t i8;
 typedef int16_t i16;
 typedef int32_t i32;
+typedef int64_t i64;
 
 typedef float f32;
 typedef double f64;
@@ -4,70 +4,266 @@
 #include <vector>
 #include <cmath>
 #include <cstring>
+#include <algorithm>
 
 #include "./tensor.h"
+#include "./quant.h"
+#include "./planner.h"
+#include "./pool.h"
 
 #define PI 3.14159265358979323846
 
-void *operator new(std::size_t s) noexcept(noexcept(operator new(1))) {
-    return std::malloc(s);
+#ifndef FFT_MAX_RADIX
+#define FFT_MAX_RADIX 64
+#endif
+
+// splits n into radices that read the same in both directions (pairs of equal primes around the product of the
+// unpaired ones), which makes the digit reversal its own inverse so it can be done with swaps. returns the number of
+// radices, or 0 when the unpaired product is over FFT_MAX_RADIX, since one butterfly's worth of values lives on the stack.
+inline u32 fft_radices(u32 n, u32 (&radices)[32]) {
+    if (n <= 1) return 0;
+    u32 half[16], pairs = 0, middle = 1;
+    for (u32 p = 2; n > 1; ++p) {
+        if (p * p > n) p = n;
+        u32 count = 0;
+        for (; n % p == 0; n /= p) ++count;
+        for (u32 i = 0; i < count / 2; ++i) half[pairs++] = p;
+        if (count % 2) middle *= p;
+        if (middle > FFT_MAX_RADIX) return 0;
+    }
+
+    u32 k = 0;
+    for (u32 i = 0; i < pairs; ++i) radices[k++] = half[i];
+    if (middle > 1) radices[k++] = middle;
+    for (u32 i = pairs; i-- > 0;) radices[k++] = half[i];
+    return k;
 }
-void *operator new[](std::size_t s) noexcept(noexcept(operator new[](1))) {
-    return std::malloc(s);
+inline bool fft_inplace_supported(u32 n) {
+    u32 radices[32];
+    return n == 1 || fft_radices(n, radices) != 0;
 }
 
-void operator delete(void *p) noexcept {
-    std::free(p);
+// unscaled in-place decimation in time dft of n values, sign is -1 for the forward transform and +1 for the inverse
+template<typename T> void fft_inplace_impl(Complex<T> *x, u32 n, T sign) {
+    u32 radices[32];
+    const u32 k = fft_radices(n, radices);
+    if (k == 0) {
+        if (n > 1) THROW(std::runtime_error, "fft size not supported in place");
+        return;
+    }
+
+    for (u32 i = 0; i < n; ++i) {
+        u32 j = 0, v = i;
+        for (u32 s = 0; s < k; ++s) {
+            j = j * radices[s] + v % radices[s];
+            v /= radices[s];
+        }
+        if (j > i) std::swap(x[i], x[j]);
+    }
+
+    Complex<T> roots[FFT_MAX_RADIX], a[FFT_MAX_RADIX];
+    for (u32 s = 0, span = 1; s < k; span *= radices[s++]) {
+        const u32 r = radices[s], m = span * r;
+        for (u32 p = 0; p < r; ++p) roots[p] = { std::cos(sign * 2 * (T)PI * p / r), std::sin(sign * 2 * (T)PI * p / r) };
+
+        for (u32 j = 0; j < span; ++j) {
+            const Complex<T> w = { std::cos(sign * 2 * (T)PI * j / m), std::sin(sign * 2 * (T)PI * j / m) };
+            for (u32 b = j; b < n; b += m) {
+                Complex<T> *v = x + b;
+                if (r == 2) {
+                    const Complex<T> t = v[span] * w;
+                    v[span] = v[0] - t;
+                    v[0] = v[0] + t;
+                    continue;
+                }
+
+                Complex<T> tw = { 1, 0 };
+                for (u32 q = 0; q < r; ++q, tw = tw * w) a[q] = v[q * span] * tw;
+                for (u32 p = 0; p < r; ++p) {
+                    Complex<T> sum = a[0];
+                    for (u32 q = 1, idx = p; q < r; ++q, idx = idx + p >= r ? idx + p - r : idx + p) sum = sum + a[q] * roots[idx];
+                    v[p * span] = sum;
+                }
+            }
+        }
+    }
+}
+template<typename T> void fft_inplace(Complex<T> *x, u32 n) {
+    fft_inplace_impl(x, n, (T)-1);
 }
-void operator delete(void *p, std::size_t) noexcept {
-    std::free(p);
+template<typename T> void ifft_inplace(Complex<T> *x, u32 n) {
+    fft_inplace_impl(x, n, (T)1);
+    for (u32 i = 0; i < n; ++i) x[i] = x[i] * ((T)1 / n);
 }
 
-void operator delete[](void *p) noexcept {
-    std::free(p);
+// real dft of n (even) samples in place, as an n / 2 point complex fft plus an unpack pass. the result is packed into
+// the same n values: bins 0 through n / 2 - 1, with the real nyquist bin stored in the (always zero) imag part of bin 0.
+template<typename T> void rfft_inplace(T *x, u32 n) {
+    if (n % 2 != 0 || !fft_inplace_supported(n / 2)) {
+        THROW(std::runtime_error, "rfft size not supported in place");
+        return;
+    }
+    const u32 m = n / 2;
+    Complex<T> *z = reinterpret_cast<Complex<T>*>(x);
+    fft_inplace(z, m);
+
+    const Complex<T> z0 = z[0];
+    z[0] = { z0.real + z0.imag, z0.real - z0.imag };
+    for (u32 k = 1; k <= m / 2; ++k) {
+        const Complex<T> a = z[k], b = conj(z[m - k]);
+        const Complex<T> e = (T)0.5 * (a + b), d = (T)0.5 * (a - b);
+        const Complex<T> w = { std::cos(-2 * (T)PI * k / n), std::sin(-2 * (T)PI * k / n) };
+        const Complex<T> t = w * Complex<T> { d.imag, -d.real };
+        z[k] = e + t;
+        z[m - k] = conj(e - t);
+    }
 }
-void operator delete[](void *p, std::size_t) noexcept {
-    std::free(p);
+// inverse of rfft_inplace: takes the packed spectrum and leaves the n real samples in its place
+template<typename T> void irfft_inplace(T *x, u32 n) {
+    if (n % 2 != 0 || !fft_inplace_supported(n / 2)) {
+        THROW(std::runtime_error, "irfft size not supported in place");
+        return;
+    }
+    const u32 m = n / 2;
+    Complex<T> *z = reinterpret_cast<Complex<T>*>(x);
+
+    const Complex<T> z0 = z[0];
+    z[0] = { (T)0.5 * (z0.real + z0.imag), (T)0.5 * (z0.real - z0.imag) };
+    for (u32 k = 1; k <= m / 2; ++k) {
+        const Complex<T> a = z[k], b = conj(z[m - k]);
+        const Complex<T> e = (T)0.5 * (a + b);
+        const Complex<T> o = (T)0.5 * (a - b) * Complex<T> { std::cos(2 * (T)PI * k / n), std::sin(2 * (T)PI * k / n) };
+        z[k] = e + Complex<T> { -o.imag, o.real };
+        z[m - k] = conj(e) + Complex<T> { o.imag, o.real };
+    }
+    ifft_inplace(z, m);
 }
 
-template<typename T> Tensor<complicate_t<T>, 1> fft_impl(const Tensor<T, 1> &x, u32 N, simplify_t<T> ang_scale, simplify_t<T> res_scale) {
-    Tensor<complicate_t<T>, 1> res { new complicate_t<T>[N], [](auto *v) { delete[] v; }, N };
+// computes the first N bins of the dft of x (len samples) into res. this is the fallback for sizes the in-place
+// transforms can't take.
+template<typename T> void fft_impl_into(complicate_t<T> *res, u32 N, const T *x, u32 len, simplify_t<T> ang_scale, simplify_t<T> res_scale) {
     for (u32 k = 0; k < N; ++k) {
         complicate_t<T> sum = {0, 0};
-        for (u32 n = 0; n < x.template dim<0>(); ++n) {
-            simplify_t<T> ang = ang_scale * k * n / x.template dim<0>();
-            sum = sum + x(n) * complicate_t<T> { std::cos(ang), std::sin(ang) };
+        for (u32 n = 0; n < len; ++n) {
+            simplify_t<T> ang = ang_scale * k * n / len;
+            sum = sum + x[n] * complicate_t<T> { std::cos(ang), std::sin(ang) };
         }
-        res(k) = res_scale * sum;
+        res[k] = res_scale * sum;
     }
+}
+template<typename T> Tensor<complicate_t<T>, 1> fft_impl(const Tensor<T, 1> &x, u32 N, simplify_t<T> ang_scale, simplify_t<T> res_scale) {
+    auto res = Tensor<complicate_t<T>, 1>::alloc(N);
+    fft_impl_into(res.row(0), N, x.row(0), x.template dim<0>(), ang_scale, res_scale);
     return res;
 }
 
-template<typename T> Tensor<complicate_t<T>, 1> fft(const Tensor<T, 1> &x) { return fft_impl(x, x.template dim<0>(), -2 * (simplify_t<T>)PI, 1); }
-template<typename T> Tensor<complicate_t<T>, 1> ifft(const Tensor<T, 1> &x) { return fft_impl(x, x.template dim<0>(), 2 * (simplify_t<T>)PI, 1.0 / x.template dim<0>()); }
+template<typename T> Complex<T> to_complex(const T &v) { return { v, 0 }; }
+template<typename T> Complex<T> to_complex(const Complex<T> &v) { return v; }
+
+template<typename T> Tensor<complicate_t<T>, 1> fft(const Tensor<T, 1> &x) {
+    const u32 n = x.template dim<0>();
+    if (!fft_inplace_supported(n)) return fft_impl(x, n, -2 * (simplify_t<T>)PI, 1);
+    auto res = Tensor<complicate_t<T>, 1>::alloc(n);
+    for (u32 i = 0; i < n; ++i) res(i) = to_complex(x(i));
+    fft_inplace(res.row(0), n);
+    return res;
+}
+template<typename T> Tensor<complicate_t<T>, 1> ifft(const Tensor<T, 1> &x) {
+    const u32 n = x.template dim<0>();
+    if (!fft_inplace_supported(n)) return fft_impl(x, n, 2 * (simplify_t<T>)PI, 1.0 / n);
+    auto res = Tensor<complicate_t<T>, 1>::alloc(n);
+    for (u32 i = 0; i < n; ++i) res(i) = to_complex(x(i));
+    ifft_inplace(res.row(0), n);
+    return res;
+}
 
-template<typename T, std::enable_if_t<std::is_same<T, simplify_t<T>>::value, int> = 0> Tensor<complicate_t<T>, 1> rfft(const Tensor<T, 1> &x) { return fft_impl(x, x.template dim<0>() / 2 + 1, -2 * PI, 1); }
+template<typename T, std::enable_if_t<std::is_same<T, simplify_t<T>>::value, int> = 0> Tensor<complicate_t<T>, 1> rfft(const Tensor<T, 1> &x) {
+    const u32 n = x.template dim<0>();
+    if (n % 2 != 0 || !fft_inplace_supported(n / 2)) return fft_impl(x, n / 2 + 1, -2 * PI, 1);
+    auto res = Tensor<complicate_t<T>, 1>::alloc(n / 2 + 1);
+    T *packed = reinterpret_cast<T*>(res.row(0));
+    for (u32 i = 0; i < n; ++i) packed[i] = x(i);
+    rfft_inplace(packed, n);
+    res(n / 2) = { res(0).imag, 0 };
+    res(0).imag = 0;
+    return res;
+}
 template<typename T> Tensor<complicate_t<T>, 1> irfft(const Tensor<T, 1> &x) {
-    Tensor<T, 1> extended { new T[2 * (x.template dim<0>() - 1)], [](auto *v) { delete[] v; }, 2 * (x.template dim<0>() - 1) };
-    for (u32 i = 0; i < x.template dim<0>(); ++i) extended(i) = x(i);
-    for (u32 i = x.template dim<0>(); i < extended.template dim<0>(); ++i) extended(i) = conj(x(extended.template dim<0>() - i));
-    return ifft(extended);
+    typedef simplify_t<T> R;
+    const u32 n = 2 * (x.template dim<0>() - 1);
+    if (!fft_inplace_supported(n / 2)) {
+        auto extended = Tensor<T, 1>::alloc(n);
+        for (u32 i = 0; i < x.template dim<0>(); ++i) extended(i) = x(i);
+        for (u32 i = x.template dim<0>(); i < n; ++i) extended(i) = conj(x(n - i));
+        return fft_impl(extended, n, 2 * (R)PI, (R)1 / n);
+    }
+
+    // the packed spectrum and then the real samples sit in the first half of the result, which is widened last
+    auto res = Tensor<complicate_t<T>, 1>::alloc(n);
+    for (u32 i = 1; i < n / 2; ++i) res(i) = x(i);
+    res(0) = { to_complex(x(0)).real, to_complex(x(n / 2)).real };
+    R *samples = reinterpret_cast<R*>(res.row(0));
+    irfft_inplace(samples, n);
+    for (u32 i = n; i-- > 0;) res(i) = { samples[i], 0 };
+    return res;
+}
+
+// real part of irfft(x) for m bins, written to res (2 * (m - 1) samples) without materializing the hermitian extension
+template<typename T> void irfft_real_into(T *res, const Complex<T> *x, u32 m) {
+    const u32 N = 2 * (m - 1);
+    const T ang_scale = 2 * (T)PI, res_scale = 1.0 / N;
+    for (u32 k = 0; k < N; ++k) {
+        T sum = 0;
+        for (u32 n = 0; n < N; ++n) {
+            const Complex<T> v = n < m ? x[n] : conj(x[N - n]);
+            T ang = ang_scale * k * n / N;
+            sum = sum + (v.real * std::cos(ang) - v.imag * std::sin(ang));
+        }
+        res[k] = res_scale * sum;
+    }
 }
 
+inline bool low_pass_filter_inplace(u32 len) {
+    return len % 2 == 0 && fft_inplace_supported(len / 2);
+}
+
+// spectrum must hold audio.dim<0>() / 2 + 1 values, unless low_pass_filter_inplace(audio.dim<0>()) says it is unused
 template<typename T, std::enable_if_t<std::is_same<T, simplify_t<T>>::value, int> = 0>
-void low_pass_filter(Tensor<T, 1> &audio, T sample_rate, T band_limit = 0) {
+void low_pass_filter_into(Tensor<T, 1> &audio, T sample_rate, T band_limit, Complex<T> *spectrum) {
+    const u32 len = audio.template dim<0>();
+    if (len % 2 != 0) {
+        THROW(std::runtime_error, "low_pass_filter requires an even number of samples");
+        return;
+    }
+
     if (band_limit == 0) band_limit = sample_rate / 2;
-    u32 cutoff_index = (u32)std::round(band_limit * audio.template dim<0>() / sample_rate);
-    auto F = rfft(audio);
-    for (u32 i = cutoff_index + 1; i < audio.template dim<0>(); ++i) audio(i) = 0;
-    auto f = irfft(F);
-    for (u32 i = 0; i < audio.template dim<0>(); ++i) audio(i) = f(i).real;
+    u32 cutoff_index = (u32)std::round(band_limit * len / sample_rate);
+    if (low_pass_filter_inplace(len)) {
+        rfft_inplace(audio.row(0), len);
+        Complex<T> *bins = reinterpret_cast<Complex<T>*>(audio.row(0));
+        for (u32 i = cutoff_index + 1; i < len / 2; ++i) bins[i] = { 0, 0 };
+        if (cutoff_index < len / 2) bins[0].imag = 0;
+        irfft_inplace(audio.row(0), len);
+        return;
+    }
+    fft_impl_into(spectrum, len / 2 + 1, audio.row(0), len, (T)(-2 * PI), (T)1);
+    for (u32 i = cutoff_index + 1; i <= len / 2; ++i) spectrum[i] = { 0, 0 };
+    irfft_real_into(audio.row(0), spectrum, len / 2 + 1);
+}
+template<typename T, std::enable_if_t<std::is_same<T, simplify_t<T>>::value, int> = 0>
+void low_pass_filter(Tensor<T, 1> &audio, T sample_rate, T band_limit = 0) {
+    const u32 len = audio.template dim<0>();
+    if (low_pass_filter_inplace(len)) {
+        low_pass_filter_into(audio, sample_rate, band_limit, static_cast<Complex<T>*>(nullptr));
+        return;
+    }
+    auto spectrum = Tensor<Complex<T>, 1>::alloc(len / 2 + 1);
+    low_pass_filter_into(audio, sample_rate, band_limit, spectrum.row(0));
 }
 
 template<typename T, std::enable_if_t<std::is_same<T, simplify_t<T>>::value, int> = 0>
 void normalize_audio(Tensor<T, 1> &audio) {
-    T s = 0;
-    for (u32 i = 0; i < audio.template dim<0>(); ++i) s = std::max(s, std::abs(audio(i)));
+    const T s = reduce_max(audio.row(0), audio.template dim<0>(), (T)0, [](auto v) { return v < -v ? -v : v; });
     if (s != 0) audio /= s;
 }
 
@@ -78,32 +274,94 @@ void mul_hann_window(Tensor<T, 1> &x) {
         x(i) *= t * t;
     }
 }
+// the copy and the window in one pass; dst may be src
+template<typename T>
+void hann_window_into(T *dst, const T *src, u32 n) {
+    for (u32 i = 0; i < n; ++i) {
+        T t = std::cos((T)PI * ((T)i - (T)n / 2) / (T)n);
+        dst[i] = src[i] * (t * t);
+    }
+}
 
-template<typename T, std::enable_if_t<std::is_same<T, simplify_t<T>>::value, int> = 0>
-Tensor<complicate_t<T>, 2> spectrogram(Tensor<T, 1> &audio, u32 fft_size, T sample_rate) {
-    low_pass_filter(audio, sample_rate);
-    normalize_audio(audio);
+inline u32 spectrogram_chunks(u32 len, u32 fft_size) {
+    return len < fft_size ? 0 : (len - fft_size) / (fft_size / 2) + 1;
+}
+// whether a frame can be transformed where it sits, leaving the bins buffers below unused
+inline bool spectrogram_inplace(u32 fft_size) {
+    return fft_size % 2 == 0 && fft_inplace_supported(fft_size / 2);
+}
+
+// low-passes and normalizes audio, then calls f(i, frame) with each hann-windowed frame, which f may overwrite.
+// frame holds fft_size samples and spectrum is the low_pass_filter_into scratch.
+template<typename T, typename F, std::enable_if_t<std::is_same<T, simplify_t<T>>::value, int> = 0>
+void spectrogram_frames(Tensor<T, 1> &audio, u32 fft_size, T sample_rate, T *frame, Complex<T> *spectrum, F f) {
+    const u32 chunks = spectrogram_chunks(audio.template dim<0>(), fft_size);
+
+    {
+        StageScope stage(STAGE_LOWPASS);
+        low_pass_filter_into(audio, sample_rate, (T)0, spectrum);
+        normalize_audio(audio);
+    }
 
-    const u32 chunks_cap = (audio.template dim<0>() - fft_size) / (fft_size / 2) + 2;
-    Tensor<T, 1> chunks[chunks_cap];
-    std::memset(&chunks, 0, sizeof(chunks));
-    u32 chunks_len = 0;
-    while (chunks_len * (fft_size / 2) + fft_size <= audio.template dim<0>()) {
-        if (chunks_len >= chunks_cap) THROW(std::runtime_error("chunks overflow"));
-        chunks[chunks_len] = Tensor<T, 1> { &audio(chunks_len * (fft_size / 2)), nullptr, +fft_size };
-        ++chunks_len;
+    StageScope stage(STAGE_SPECTROGRAM);
+    for (u32 i = 0; i < chunks; ++i) {
+        hann_window_into(frame, audio.row(0) + i * (fft_size / 2), fft_size);
+        f(i, frame);
     }
+}
 
-    for (u32 i = 0; i < chunks_len; ++i) {
-        chunks[i] = static_cast<Tensor<T, 1>&&>(chunks[i]).into_owned();
-        mul_hann_window(chunks[i]);
+// the first fft_size / 2 bins of a windowed frame. frames of in-place sizes become their own packed spectrum and
+// bins is left alone; otherwise the naive dft writes to bins. returns where the bins are, with bin 0 real either way.
+template<typename T>
+Complex<T> *spectrogram_frame_bins(T *frame, u32 fft_size, Complex<T> *bins) {
+    if (!spectrogram_inplace(fft_size)) {
+        fft_impl_into(bins, fft_size / 2, frame, fft_size, -2 * (T)PI, (T)1);
+        return bins;
     }
+    rfft_inplace(frame, fft_size);
+    Complex<T> *packed = reinterpret_cast<Complex<T>*>(frame);
+    packed[0].imag = 0;
+    return packed;
+}
+
+// res is chunks x fft_size / 2
+template<typename T, std::enable_if_t<std::is_same<T, simplify_t<T>>::value, int> = 0>
+void spectrogram_into(Tensor<Complex<T>, 2> &res, Tensor<T, 1> &audio, u32 fft_size, T sample_rate, T *frame, Complex<T> *spectrum) {
+    if (res.template dim<0>() != spectrogram_chunks(audio.template dim<0>(), fft_size) || res.template dim<1>() != fft_size / 2) {
+        THROW(std::runtime_error, "spectrogram incompatible sizes");
+        return;
+    }
+    spectrogram_frames(audio, fft_size, sample_rate, frame, spectrum, [&](u32 i, T *x) {
+        const Complex<T> *bins = spectrogram_frame_bins(x, fft_size, res.row(i));
+        if (bins != res.row(i)) for (u32 j = 0; j < fft_size / 2; ++j) res(i, j) = bins[j];
+    });
+}
 
-    Tensor<complicate_t<T>, 2> res { new complicate_t<T>[chunks_len * (fft_size / 2)], [](auto *v) { delete[] v; }, chunks_len, fft_size / 2 };
-    for (u32 i = 0; i < chunks_len; ++i) {
-        Tensor<complicate_t<T>, 1> F = fft(chunks[i]);
-        for (u32 j = 0; j < fft_size / 2; ++j) res(i, j) = F(j);
+// the transposed power spectrogram (fft_size / 2 x chunks) computed a frame at a time, so the complex spectrogram
+// never exists as a whole; bins holds fft_size / 2 values unless spectrogram_inplace(fft_size)
+template<typename T, std::enable_if_t<std::is_same<T, simplify_t<T>>::value, int> = 0>
+void power_spectrogram_into(Tensor<T, 2> &res, Tensor<T, 1> &audio, u32 fft_size, T sample_rate, T *frame, Complex<T> *bins, Complex<T> *spectrum) {
+    if (res.template dim<1>() != spectrogram_chunks(audio.template dim<0>(), fft_size) || res.template dim<0>() != fft_size / 2) {
+        THROW(std::runtime_error, "spectrogram incompatible sizes");
+        return;
     }
+    spectrogram_frames(audio, fft_size, sample_rate, frame, spectrum, [&](u32 i, T *x) {
+        const Complex<T> *b = spectrogram_frame_bins(x, fft_size, bins);
+        for (u32 j = 0; j < fft_size / 2; ++j) res(j, i) = sqr_mag(b[j]);
+    });
+}
+template<typename T, std::enable_if_t<std::is_same<T, simplify_t<T>>::value, int> = 0>
+Tensor<complicate_t<T>, 2> spectrogram(Tensor<T, 1> &audio, u32 fft_size, T sample_rate) {
+    StageScope stage(STAGE_SPECTROGRAM);
+    const u32 len = audio.template dim<0>();
+    auto res = Tensor<complicate_t<T>, 2>::alloc(spectrogram_chunks(len, fft_size), fft_size / 2);
+    auto frame = Tensor<T, 1>::alloc(fft_size);
+    if (low_pass_filter_inplace(len)) {
+        spectrogram_into(res, audio, fft_size, sample_rate, frame.row(0), static_cast<Complex<T>*>(nullptr));
+        return res;
+    }
+    auto spectrum = Tensor<Complex<T>, 1>::alloc(len / 2 + 1);
+    spectrogram_into(res, audio, fft_size, sample_rate, frame.row(0), spectrum.row(0));
     return res;
 }
 
@@ -115,108 +373,560 @@ template<typename T, std::enable_if_t<std::is_same<T, simplify_t<T>>::value, int
 }
 
 template<typename T, std::enable_if_t<std::is_same<T, simplify_t<T>>::value, int> = 0>
-Tensor<T, 2> dct(u32 in_filters, u32 out_filters) {
+void dct_into(Tensor<T, 2> &res) {
+    const u32 out_filters = res.template dim<0>(), in_filters = res.template dim<1>();
     T t1 = 1 / std::sqrt((T)in_filters);
     T t2 = std::sqrt(2 / (T)in_filters);
     T t3 = (T)PI / (2 * (T)in_filters);
 
-    Tensor<T, 2> res { new T[in_filters * out_filters], [](auto *v) { delete[] v; }, out_filters, in_filters };
+    if (out_filters == 0) return;
     for (u32 j = 0; j < in_filters; ++j) res(0, j) = t1;
     for (u32 i = 1; i < out_filters; ++i) {
         for (u32 j = 0; j < in_filters; ++j) res(i, j) = std::cos(i * (1 + 2 * j) * t3) * t2;
     }
+}
+template<typename T, std::enable_if_t<std::is_same<T, simplify_t<T>>::value, int> = 0>
+Tensor<T, 2> dct(u32 in_filters, u32 out_filters) {
+    auto res = Tensor<T, 2>::alloc(out_filters, in_filters);
+    dct_into(res);
     return res;
 }
 
-template<typename T> Tensor<T, 1> linspace(T a, T b, u32 num) {
-    Tensor<T, 1> res { new T[num], [](auto *v) { delete[] v; }, num };
+template<typename T> void linspace_into(T *res, T a, T b, u32 num) {
     T step = (b - a) / (num - 1);
     T val = a;
-    for (u32 i = 0; i < res.template dim<0>(); ++i, val += step) res(i) = val;
+    for (u32 i = 0; i < num; ++i, val += step) res[i] = val;
+}
+template<typename T> Tensor<T, 1> linspace(T a, T b, u32 num) {
+    auto res = Tensor<T, 1>::alloc(num);
+    linspace_into(res.row(0), a, b, num);
     return res;
 }
 
-template<typename T> Tensor<T, 2> transpose(const Tensor<T, 2> &x) {
-    Tensor<T, 2> res { new T[x.size()], [](auto *v) { delete[] v; }, x.template dim<1>(), x.template dim<0>() };
-    for (u32 i = 0; i < x.template dim<0>(); ++i) {
-        for (u32 j = 0; j < x.template dim<1>(); ++j) {
-            res(j, i) = x(i, j);
+#ifndef TRANSPOSE_TILE
+#define TRANSPOSE_TILE 16
+#endif
+
+// cache-oblivious: split the longer side until the block fits a tile, so both read and write sides stay cache resident
+template<typename T, typename U, typename F> void transpose_kernel(u32 rows, u32 cols, const T *src, u32 lds, U *dst, u32 ldd, F &f) {
+    if (rows <= TRANSPOSE_TILE && cols <= TRANSPOSE_TILE) {
+        for (u32 i = 0; i < rows; ++i) {
+            for (u32 j = 0; j < cols; ++j) dst[j * ldd + i] = f(src[i * lds + j]);
         }
+    } else if (rows >= cols) {
+        const u32 h = rows / 2;
+        transpose_kernel(h, cols, src, lds, dst, ldd, f);
+        transpose_kernel(rows - h, cols, src + h * lds, lds, dst + h, ldd, f);
+    } else {
+        const u32 h = cols / 2;
+        transpose_kernel(rows, h, src, lds, dst, ldd, f);
+        transpose_kernel(rows, cols - h, src + h, lds, dst + h * ldd, ldd, f);
     }
-    return res;
 }
 
-template<typename T> Tensor<T, 2> matmul(const Tensor<T, 2> &a, const Tensor<T, 2> &b) {
-    if (a.template dim<1>() != b.template dim<0>()) THROW(std::runtime_error("matmul incompatible sizes"));
+template<typename T, typename U, typename F> void transpose_into(Tensor<U, 2> &res, const Tensor<T, 2> &x, F f) {
+    if (res.template dim<0>() != x.template dim<1>() || res.template dim<1>() != x.template dim<0>()) {
+        THROW(std::runtime_error, "transpose incompatible sizes");
+        return;
+    }
+    if (x.size() == 0) return;
+    transpose_kernel(x.template dim<0>(), x.template dim<1>(), x.row(0), x.stride(), res.row(0), res.stride(), f);
+}
+template<typename T> void transpose_into(Tensor<T, 2> &res, const Tensor<T, 2> &x) {
+    transpose_into(res, x, [](const T &v) { return v; });
+}
+
+template<typename T, typename F> auto transpose_map(const Tensor<T, 2> &x, F f) -> Tensor<std::decay_t<decltype(f(x(0, 0)))>, 2> {
+    auto res = Tensor<std::decay_t<decltype(f(x(0, 0)))>, 2>::alloc(x.template dim<1>(), x.template dim<0>());
+    transpose_into(res, x, f);
+    return res;
+}
+template<typename T> Tensor<T, 2> transpose(const Tensor<T, 2> &x) {
+    auto res = Tensor<T, 2>::alloc(x.template dim<1>(), x.template dim<0>());
+    transpose_into(res, x);
+    return res;
+}
 
-    Tensor<T, 2> res { new T[a.template dim<0>() * b.template dim<1>()], [](auto *v) { delete[] v; }, a.template dim<0>(), b.template dim<1>() };
-    for (u32 i = 0; i < res.template dim<0>(); ++i) {
-        for (u32 j = 0; j < res.template dim<1>(); ++j) {
-            T acc = (T)0;
-            for (u32 k = 0; k < a.template dim<1>(); ++k) acc += a(i, k) * b(k, j);
-            res(i, j) = acc;
+template<typename T> void transpose_inplace(Tensor<T, 2> &x) {
+    if (x.template dim<0>() != x.template dim<1>()) {
+        THROW(std::runtime_error, "in-place transpose requires a square matrix");
+        return;
+    }
+    const u32 n = x.template dim<0>(), ld = x.stride();
+    if (n == 0) return;
+    T *p = x.row(0);
+    for (u32 bi = 0; bi < n; bi += TRANSPOSE_TILE) {
+        const u32 ei = std::min<u32>(n, bi + TRANSPOSE_TILE);
+        for (u32 i = bi; i < ei; ++i) {
+            for (u32 j = bi; j < i; ++j) std::swap(p[i * ld + j], p[j * ld + i]);
+        }
+        for (u32 bj = ei; bj < n; bj += TRANSPOSE_TILE) {
+            const u32 ej = std::min<u32>(n, bj + TRANSPOSE_TILE);
+            for (u32 i = bi; i < ei; ++i) {
+                for (u32 j = bj; j < ej; ++j) std::swap(p[i * ld + j], p[j * ld + i]);
+            }
         }
     }
-    return res;
 }
 
-template<typename T, std::enable_if_t<std::is_same<T, simplify_t<T>>::value, int> = 0>
-Tensor<T, 2> mfcc_spectrogram(Tensor<T, 1> &signal, u32 fft_size, T sample_rate, u32 mel_filters, u32 dct_filters) {
-    Tensor<T, 1> mel_freqs = linspace(freq_to_mel((T)0), freq_to_mel(sample_rate / (T)2), mel_filters + 2);
-    for (u32 i = 0; i < mel_freqs.template dim<0>(); ++i) mel_freqs(i) = mel_to_freq(mel_freqs(i));
+#if defined(__ARM_ARCH_7EM__)
+#ifndef MATMUL_MR
+#define MATMUL_MR 4
+#endif
+#ifndef MATMUL_NR
+#define MATMUL_NR 4
+#endif
+#ifndef MATMUL_MC
+#define MATMUL_MC 16
+#endif
+#ifndef MATMUL_KC
+#define MATMUL_KC 64
+#endif
+#ifndef MATMUL_NC
+#define MATMUL_NC 64
+#endif
+#else
+#ifndef MATMUL_MR
+#define MATMUL_MR 4
+#endif
+#ifndef MATMUL_NR
+#define MATMUL_NR 8
+#endif
+#ifndef MATMUL_MC
+#define MATMUL_MC 64
+#endif
+#ifndef MATMUL_KC
+#define MATMUL_KC 256
+#endif
+#ifndef MATMUL_NC
+#define MATMUL_NC 512
+#endif
+#endif
+#ifndef MATMUL_SKINNY_M
+#define MATMUL_SKINNY_M 16
+#endif
 
-    Tensor<u32, 1> filter_points { new u32[mel_freqs.template dim<0>()], [](auto *v) { delete[] v; }, mel_freqs.template dim<0>() };
-    for (u32 i = 0; i < filter_points.template dim<0>(); ++i) filter_points(i) = ((T)fft_size / sample_rate) * mel_freqs(i);
+// y[i * incy] = sum_p a[i * lda + p] * x[p * incx]
+template<typename T> void gemv_kernel(u32 m, u32 k, const T *a, u32 lda, const T *x, u32 incx, T *y, u32 incy) {
+    u32 i = 0;
+    for (; i + 4 <= m; i += 4) {
+        const T *a0 = a + i * lda, *a1 = a0 + lda, *a2 = a1 + lda, *a3 = a2 + lda;
+        T s0 = (T)0, s1 = (T)0, s2 = (T)0, s3 = (T)0;
+        for (u32 p = 0; p < k; ++p) {
+            const T v = x[p * incx];
+            s0 += a0[p] * v;
+            s1 += a1[p] * v;
+            s2 += a2[p] * v;
+            s3 += a3[p] * v;
+        }
+        y[i * incy] = s0;
+        y[(i + 1) * incy] = s1;
+        y[(i + 2) * incy] = s2;
+        y[(i + 3) * incy] = s3;
+    }
+    for (; i < m; ++i) {
+        const T *ai = a + i * lda;
+        T s = (T)0;
+        for (u32 p = 0; p < k; ++p) s += ai[p] * x[p * incx];
+        y[i * incy] = s;
+    }
+}
 
-    u32 size = mel_filters * (fft_size / 2);
-    T *p = new T[size];
-    for (u32 i = 0; i < size; ++i) p[i] = (T)0;
-    Tensor<T, 2> filters { p, [](auto *v) { delete[] v; }, mel_filters, fft_size / 2 };
+// few rows of A: accumulate whole rows of C at once (c_i += a_ip * b_p), which streams B and C contiguously without packing
+template<typename T> void skinny_kernel(u32 m, u32 n, u32 k, const T *a, u32 lda, const T *b, u32 ldb, T *c, u32 ldc) {
+    u32 i = 0;
+    for (; i + 4 <= m; i += 4) {
+        T *c0 = c + i * ldc, *c1 = c0 + ldc, *c2 = c1 + ldc, *c3 = c2 + ldc;
+        const T *a0 = a + i * lda, *a1 = a0 + lda, *a2 = a1 + lda, *a3 = a2 + lda;
+        for (u32 j = 0; j < n; ++j) c0[j] = c1[j] = c2[j] = c3[j] = (T)0;
+        for (u32 p = 0; p < k; ++p) {
+            const T *bp = b + p * ldb;
+            const T v0 = a0[p], v1 = a1[p], v2 = a2[p], v3 = a3[p];
+            for (u32 j = 0; j < n; ++j) {
+                const T w = bp[j];
+                c0[j] += v0 * w;
+                c1[j] += v1 * w;
+                c2[j] += v2 * w;
+                c3[j] += v3 * w;
+            }
+        }
+    }
+    for (; i < m; ++i) {
+        T *ci = c + i * ldc;
+        const T *ai = a + i * lda;
+        for (u32 j = 0; j < n; ++j) ci[j] = (T)0;
+        for (u32 p = 0; p < k; ++p) {
+            const T *bp = b + p * ldb;
+            const T v = ai[p];
+            for (u32 j = 0; j < n; ++j) ci[j] += v * bp[j];
+        }
+    }
+}
 
-    for (u32 n = 0; n < mel_filters; ++n) {
-        T s = (T)2 / (mel_freqs(n + 2) - mel_freqs(n));
-        Tensor<T, 1> temp = linspace((T)0, (T)1, filter_points(n + 1) - filter_points(n));
-        for (u32 m = filter_points(n); m < filter_points(n + 1); ++m) filters(n, m) = s * temp(m - filter_points(n));
-        temp = linspace((T)1, (T)0, filter_points(n + 2) - filter_points(n + 1));
-        for (u32 m = filter_points(n + 1); m < filter_points(n + 2); ++m) filters(n, m) = s * temp(m - filter_points(n + 1));
+// packs a kc x nc block of B into NR-wide column panels, each stored k-major and zero-padded to NR
+template<typename T> void pack_b(u32 kc, u32 nc, const T *b, u32 ldb, T *dst) {
+    for (u32 j = 0; j < nc; j += MATMUL_NR) {
+        const u32 nr = std::min<u32>(MATMUL_NR, nc - j);
+        for (u32 p = 0; p < kc; ++p, dst += MATMUL_NR) {
+            const T *src = b + p * ldb + j;
+            u32 q = 0;
+            for (; q < nr; ++q) dst[q] = src[q];
+            for (; q < MATMUL_NR; ++q) dst[q] = (T)0;
+        }
     }
+}
 
-    Tensor<Complex<T>, 2> power_complex = spectrogram(signal, fft_size, sample_rate);
-    Tensor<T, 2> power_trans { new T[power_complex.size()], [](auto *v) { delete[] v; }, power_complex.template dim<1>(), power_complex.template dim<0>() };
-    for (u32 i = 0; i < power_trans.template dim<0>(); ++i) {
-        for (u32 j = 0; j < power_trans.template dim<1>(); ++j) {
-            power_trans(i, j) = sqr_mag(power_complex(j, i));
+// packs an mc x kc block of A into MR-tall row panels, each stored k-major and zero-padded to MR
+template<typename T> void pack_a(u32 mc, u32 kc, const T *a, u32 lda, T *dst) {
+    for (u32 i = 0; i < mc; i += MATMUL_MR) {
+        const u32 mr = std::min<u32>(MATMUL_MR, mc - i);
+        for (u32 p = 0; p < kc; ++p, dst += MATMUL_MR) {
+            u32 q = 0;
+            for (; q < mr; ++q) dst[q] = a[(i + q) * lda + p];
+            for (; q < MATMUL_MR; ++q) dst[q] = (T)0;
         }
     }
+}
 
-    Tensor<T, 2> filtered = matmul(filters, power_trans);
-    for (u32 i = 0; i < filtered.template dim<0>(); ++i) {
-        for (u32 j = 0; j < filtered.template dim<1>(); ++j) {
-            if (filtered(i, j) > 0) {
-                filtered(i, j) = 10 * std::log10(filtered(i, j));
+template<typename T> void micro_kernel(u32 kc, const T *ap, const T *bp, T *c, u32 ldc, u32 mr, u32 nr, bool accumulate) {
+    T acc[MATMUL_MR][MATMUL_NR] = {};
+    for (u32 p = 0; p < kc; ++p, ap += MATMUL_MR, bp += MATMUL_NR) {
+        for (u32 i = 0; i < MATMUL_MR; ++i) {
+            const T v = ap[i];
+            for (u32 j = 0; j < MATMUL_NR; ++j) acc[i][j] += v * bp[j];
+        }
+    }
+    for (u32 i = 0; i < mr; ++i) {
+        T *ci = c + i * ldc;
+        if (accumulate) for (u32 j = 0; j < nr; ++j) ci[j] += acc[i][j];
+        else for (u32 j = 0; j < nr; ++j) ci[j] = acc[i][j];
+    }
+}
+
+constexpr u32 matmul_pack_size() {
+    return MATMUL_KC * ((MATMUL_NC + MATMUL_NR - 1) / MATMUL_NR * MATMUL_NR) + MATMUL_KC * ((MATMUL_MC + MATMUL_MR - 1) / MATMUL_MR * MATMUL_MR);
+}
+
+// cache-blocked product of packed panels; pack must hold matmul_pack_size() elements
+template<typename T> void blocked_kernel(u32 m, u32 n, u32 k, const T *a, u32 lda, const T *b, u32 ldb, T *c, u32 ldc, T *pack) {
+    T *bpack = pack;
+    T *apack = pack + MATMUL_KC * ((MATMUL_NC + MATMUL_NR - 1) / MATMUL_NR * MATMUL_NR);
+    for (u32 jc = 0; jc < n; jc += MATMUL_NC) {
+        const u32 nc = std::min<u32>(MATMUL_NC, n - jc);
+        for (u32 pc = 0; pc < k; pc += MATMUL_KC) {
+            const u32 kc = std::min<u32>(MATMUL_KC, k - pc);
+            pack_b(kc, nc, b + pc * ldb + jc, ldb, bpack);
+            for (u32 ic = 0; ic < m; ic += MATMUL_MC) {
+                const u32 mc = std::min<u32>(MATMUL_MC, m - ic);
+                pack_a(mc, kc, a + ic * lda + pc, lda, apack);
+                for (u32 jr = 0; jr < nc; jr += MATMUL_NR) {
+                    for (u32 ir = 0; ir < mc; ir += MATMUL_MR) {
+                        micro_kernel(kc, apack + ir * kc, bpack + jr * kc, c + (ic + ir) * ldc + jc + jr, ldc,
+                            std::min<u32>(MATMUL_MR, mc - ir), std::min<u32>(MATMUL_NR, nc - jr), pc != 0);
+                    }
+                }
             }
         }
     }
+}
+
+template<typename T> void matmul_into(Tensor<T, 2> &res, const Tensor<T, 2> &a, const Tensor<T, 2> &b, T *pack = nullptr) {
+    if (a.template dim<1>() != b.template dim<0>() || res.template dim<0>() != a.template dim<0>() || res.template dim<1>() != b.template dim<1>()) {
+        THROW(std::runtime_error, "matmul incompatible sizes");
+        return;
+    }
 
-    return matmul(dct<T>(mel_filters, dct_filters), filtered);
+    const u32 m = a.template dim<0>(), n = b.template dim<1>(), k = a.template dim<1>();
+    if (m == 0 || n == 0) return;
+    if (k == 0) {
+        res.fill((T)0);
+        return;
+    }
+
+    if (n == 1) {
+        gemv_kernel(m, k, a.row(0), a.stride(), b.row(0), b.stride(), res.row(0), res.stride());
+    } else if (m <= MATMUL_SKINNY_M) {
+        skinny_kernel(m, n, k, a.row(0), a.stride(), b.row(0), b.stride(), res.row(0), res.stride());
+    } else if (pack) {
+        blocked_kernel(m, n, k, a.row(0), a.stride(), b.row(0), b.stride(), res.row(0), res.stride(), pack);
+    } else {
+        T *p = aligned_new<T>(matmul_pack_size());
+        blocked_kernel(m, n, k, a.row(0), a.stride(), b.row(0), b.stride(), res.row(0), res.stride(), p);
+        aligned_delete(p);
+    }
 }
 
+// elements of pack scratch matmul_into needs for an m x n result, 0 when it never packs
+inline u32 matmul_scratch_size(u32 m, u32 n) {
+    return n > 1 && m > MATMUL_SKINNY_M ? matmul_pack_size() : 0;
+}
+
+template<typename T> Tensor<T, 2> matmul(const Tensor<T, 2> &a, const Tensor<T, 2> &b) {
+    if (a.template dim<1>() != b.template dim<0>()) {
+        THROW(std::runtime_error, "matmul incompatible sizes");
+        return {};
+    }
+
+    auto res = Tensor<T, 2>::alloc(a.template dim<0>(), b.template dim<1>());
+    matmul_into(res, a, b);
+    return res;
+}
+
+// triangular mel filterbank over the first fft_size / 2 bins; mel_freqs holds filters.dim<0>() + 2 values
 template<typename T, std::enable_if_t<std::is_same<T, simplify_t<T>>::value, int> = 0>
-Tensor<T, 2> mfcc_spectrogram_for_learning(Tensor<T, 1> &signal, T sample_rate) {
-    u32 fft_size = (u32)(i32)((T)30 / (T)1000 * sample_rate);
+void mel_filters_into(Tensor<T, 2> &filters, u32 fft_size, T sample_rate, T *mel_freqs) {
+    const u32 mel_filters = filters.template dim<0>();
+    if (filters.template dim<1>() != fft_size / 2) {
+        THROW(std::runtime_error, "mel filters incompatible sizes");
+        return;
+    }
 
-    if ((i32)fft_size <= 0) THROW(std::runtime_error("mfcc_spectrogram_for_learning: input too small!"));
+    linspace_into(mel_freqs, freq_to_mel((T)0), freq_to_mel(sample_rate / (T)2), mel_filters + 2);
+    for (u32 i = 0; i < mel_filters + 2; ++i) mel_freqs[i] = mel_to_freq(mel_freqs[i]);
+    auto point = [&](u32 i) -> u32 { return ((T)fft_size / sample_rate) * mel_freqs[i]; };
 
-    Tensor<T, 2> s = mfcc_spectrogram(signal, fft_size, sample_rate, 16, 16);
+    filters.fill((T)0);
+    for (u32 n = 0; n < mel_filters; ++n) {
+        T s = (T)2 / (mel_freqs[n + 2] - mel_freqs[n]);
+        const u32 p0 = point(n), p1 = point(n + 1), p2 = point(n + 2);
+
+        // the same ramps linspace would produce, without the temporaries
+        T step = ((T)1 - (T)0) / (p1 - p0 - 1), val = 0;
+        for (u32 m = p0; m < p1; ++m, val += step) filters(n, m) = s * val;
+        step = ((T)0 - (T)1) / (p2 - p1 - 1), val = 1;
+        for (u32 m = p1; m < p2; ++m, val += step) filters(n, m) = s * val;
+    }
+}
+
+template<typename T, std::enable_if_t<std::is_same<T, simplify_t<T>>::value, int> = 0>
+void power_to_db(Tensor<T, 2> &x) {
+    for (u32 i = 0; i < x.template dim<0>(); ++i) {
+        for (u32 j = 0; j < x.template dim<1>(); ++j) {
+            if (x(i, j) > 0) {
+                x(i, j) = 10 * std::log10(x(i, j));
+            }
+        }
+    }
+}
+
+template<typename T, std::enable_if_t<std::is_same<T, simplify_t<T>>::value, int> = 0>
+Tensor<T, 2> mfcc_spectrogram(Tensor<T, 1> &signal, u32 fft_size, T sample_rate, u32 mel_filters, u32 dct_filters) {
+    StageScope stage(STAGE_MEL);
+    auto filters = Tensor<T, 2>::alloc(mel_filters, fft_size / 2);
+    auto mel_freqs = Tensor<T, 1>::alloc(mel_filters + 2);
+    mel_filters_into(filters, fft_size, sample_rate, mel_freqs.row(0));
+
+    Tensor<T, 2> power_trans;
+    {
+        StageScope stage(STAGE_SPECTROGRAM);
+        Tensor<Complex<T>, 2> power_complex = spectrogram(signal, fft_size, sample_rate);
+        power_trans = transpose_map(power_complex, [](const Complex<T> &v) { return sqr_mag(v); });
+    }
+
+    Tensor<T, 2> filtered = matmul(filters, power_trans);
+    power_to_db(filtered);
 
+    pool_set_stage(STAGE_DCT);
+    return matmul(dct<T>(mel_filters, dct_filters), filtered);
+}
+
+template<typename T, std::enable_if_t<std::is_same<T, simplify_t<T>>::value, int> = 0>
+void normalize_for_learning(Tensor<T, 2> &s) {
+    StageScope stage(STAGE_NORMALIZE);
     T std = s.std();
 
     s -= s.mean();
     if (std > (T)0) s /= std;
     s.maximum((T)(-1));
     s.minimum((T)(+1));
+}
+
+// normalize_for_learning with the result quantized into dst as it is produced, for models that take int8 input.
+// the values match quantizing the output of normalize_for_learning; s itself is left untouched.
+template<typename T, std::enable_if_t<std::is_same<T, simplify_t<T>>::value, int> = 0>
+void normalize_for_learning_into(QTensor<i8, 2> &dst, Tensor<T, 2> &s) {
+    StageScope stage(STAGE_NORMALIZE);
+    if (dst.template dim<0>() != s.template dim<0>() || dst.template dim<1>() != s.template dim<1>()) {
+        THROW(std::runtime_error, "normalize_for_learning: incompatible sizes");
+        return;
+    }
+    const T std = s.std(), mean = s.mean();
+    for (u32 i = 0; i < s.template dim<0>(); ++i) {
+        const T *src = s.row(i);
+        i8 *q = dst.data.row(i);
+        for (u32 j = 0; j < s.template dim<1>(); ++j) {
+            T v = src[j] - mean;
+            if (std > (T)0) v /= std;
+            v = std::min(std::max(v, (T)(-1)), (T)(+1));
+            q[j] = quantize_value<i8>((f32)v, dst.params);
+        }
+    }
+}
+
+template<typename T, std::enable_if_t<std::is_same<T, simplify_t<T>>::value, int> = 0>
+u32 learning_fft_size(T sample_rate) {
+    return (u32)(i32)((T)30 / (T)1000 * sample_rate);
+}
+
+template<typename T, std::enable_if_t<std::is_same<T, simplify_t<T>>::value, int> = 0>
+Tensor<T, 2> mfcc_spectrogram_for_learning(Tensor<T, 1> &signal, T sample_rate) {
+    u32 fft_size = learning_fft_size(sample_rate);
+
+    if ((i32)fft_size <= 0) {
+        THROW(std::runtime_error, "mfcc_spectrogram_for_learning: input too small!");
+        return {};
+    }
+
+    Tensor<T, 2> s = mfcc_spectrogram(signal, fft_size, sample_rate, 16, 16);
+    normalize_for_learning(s);
+    return s;
+}
+
+// every intermediate of the mfcc frontend placed in one region by lifetime, so the frontend
+// needs the largest live set rather than the sum of all its buffers
+template<typename T> struct FrontendPlan {
+    static_assert(std::is_same<T, simplify_t<T>>::value, "FrontendPlan is for real sample types");
+
+    enum Buffer : u32 { LOWPASS, FRAME, BINS, POWER, MEL_FREQS, FILTERS, MEL, DCT, PACK, OUTPUT, BUFFER_COUNT };
+
+    u32 signal_len, fft_size, chunks, mel_filters, dct_filters;
+    T sample_rate;
+    BufferSpec buffers[BUFFER_COUNT];
+    u32 offsets[BUFFER_COUNT];
+    u32 region_size;
+
+    // with external_output the caller supplies the result (e.g. the model's input tensor), so the plan leaves it out
+    static FrontendPlan make(u32 signal_len, u32 fft_size, T sample_rate, u32 mel_filters, u32 dct_filters, bool external_output = false) {
+        FrontendPlan p;
+        p.signal_len = signal_len;
+        p.fft_size = fft_size;
+        p.chunks = spectrogram_chunks(signal_len, fft_size);
+        p.mel_filters = mel_filters;
+        p.dct_filters = dct_filters;
+        p.sample_rate = sample_rate;
+
+        const u32 bins = fft_size / 2;
+        const u32 pack = std::max(matmul_scratch_size(mel_filters, p.chunks), matmul_scratch_size(dct_filters, p.chunks));
+        auto matrix = [](u32 rows, u32 cols, u32 elem) { return rows * Tensor<T, 2>::padded_stride(default_alloc_policy, cols) * elem; };
+
+        // steps: 0 low pass, 1 framing + fft + power, 2 filterbank, 3 mel projection, 4 dct, 5 normalization
+        // the low pass and the frame transforms run in place when their sizes allow it
+        p.buffers[LOWPASS] = { low_pass_filter_inplace(signal_len) ? 0 : (signal_len / 2 + 1) * (u32)sizeof(Complex<T>), TENSOR_ALIGN, 0, 0 };
+        p.buffers[FRAME] = { fft_size * (u32)sizeof(T), TENSOR_ALIGN, 1, 1 };
+        p.buffers[BINS] = { spectrogram_inplace(fft_size) ? 0 : bins * (u32)sizeof(Complex<T>), TENSOR_ALIGN, 1, 1 };
+        p.buffers[POWER] = { matrix(bins, p.chunks, sizeof(T)), TENSOR_ALIGN, 1, 3 };
+        p.buffers[MEL_FREQS] = { (mel_filters + 2) * (u32)sizeof(T), TENSOR_ALIGN, 2, 2 };
+        p.buffers[FILTERS] = { matrix(mel_filters, bins, sizeof(T)), TENSOR_ALIGN, 2, 3 };
+        p.buffers[MEL] = { matrix(mel_filters, p.chunks, sizeof(T)), TENSOR_ALIGN, 3, 4 };
+        p.buffers[DCT] = { matrix(dct_filters, mel_filters, sizeof(T)), TENSOR_ALIGN, 4, 4 };
+        p.buffers[PACK] = { pack * (u32)sizeof(T), TENSOR_ALIGN, 3, 4 };
+        p.buffers[OUTPUT] = { external_output ? 0 : matrix(dct_filters, p.chunks, sizeof(T)), TENSOR_ALIGN, 4, 5 };
+
+        p.region_size = plan_buffers(p.buffers, BUFFER_COUNT, p.offsets);
+        return p;
+    }
+    static FrontendPlan for_learning(u32 signal_len, T sample_rate, bool external_output = false) {
+        return make(signal_len, learning_fft_size(sample_rate), sample_rate, 16, 16, external_output);
+    }
+
+    // what allocating every buffer separately would cost
+    u32 unplanned_size() const {
+        u32 res = 0;
+        for (u32 i = 0; i < BUFFER_COUNT; ++i) res += buffers[i].size;
+        return res;
+    }
+
+    template<typename U> U *at(u8 *region, Buffer b) const {
+        return reinterpret_cast<U*>(region + offsets[b]);
+    }
+    template<typename U> Tensor<U, 2> matrix(u8 *region, Buffer b, u32 rows, u32 cols) const {
+        return Tensor<U, 2>::strided(at<U>(region, b), nullptr, Tensor<U, 2>::padded_stride(default_alloc_policy, cols), rows, cols);
+    }
+};
+
+// runs the frontend entirely inside region (plan.region_size bytes, TENSOR_ALIGN aligned) and writes the
+// dct_filters x chunks result into res, which must not overlap region
+template<typename T, std::enable_if_t<std::is_same<T, simplify_t<T>>::value, int> = 0>
+void mfcc_spectrogram_into(Tensor<T, 2> &res, Tensor<T, 1> &signal, const FrontendPlan<T> &plan, u8 *region) {
+    typedef FrontendPlan<T> P;
+    if (res.template dim<0>() != plan.dct_filters || res.template dim<1>() != plan.chunks) {
+        THROW(std::runtime_error, "mfcc_spectrogram: output does not match plan");
+        return;
+    }
+    if (signal.template dim<0>() != plan.signal_len) {
+        THROW(std::runtime_error, "mfcc_spectrogram: signal does not match plan");
+        return;
+    }
+    if (reinterpret_cast<uintptr_t>(region) % TENSOR_ALIGN != 0) {
+        THROW(std::runtime_error, "mfcc_spectrogram: misaligned region");
+        return;
+    }
+
+    const u32 bins = plan.fft_size / 2;
+    Tensor<T, 2> power = plan.template matrix<T>(region, P::POWER, bins, plan.chunks);
+    power_spectrogram_into(power, signal, plan.fft_size, plan.sample_rate, plan.template at<T>(region, P::FRAME),
+        plan.template at<Complex<T>>(region, P::BINS), plan.template at<Complex<T>>(region, P::LOWPASS));
+
+    Tensor<T, 2> filters = plan.template matrix<T>(region, P::FILTERS, plan.mel_filters, bins);
+    mel_filters_into(filters, plan.fft_size, plan.sample_rate, plan.template at<T>(region, P::MEL_FREQS));
+
+    Tensor<T, 2> filtered = plan.template matrix<T>(region, P::MEL, plan.mel_filters, plan.chunks);
+    Tensor<T, 2> dct_mat = plan.template matrix<T>(region, P::DCT, plan.dct_filters, plan.mel_filters);
+    T *pack = plan.buffers[P::PACK].size ? plan.template at<T>(region, P::PACK) : nullptr;
+
+    // the dct matrix overwrites the filterbank, so the mel projection has to happen first
+    StageScope stage(STAGE_MEL);
+    matmul_into(filtered, filters, power, pack);
+    power_to_db(filtered);
+    pool_set_stage(STAGE_DCT);
+    dct_into(dct_mat);
+    matmul_into(res, dct_mat, filtered, pack);
+}
 
+// same as mfcc_spectrogram_into, with the result as a view into region that is only valid until the region is reused
+template<typename T, std::enable_if_t<std::is_same<T, simplify_t<T>>::value, int> = 0>
+Tensor<T, 2> mfcc_spectrogram(Tensor<T, 1> &signal, const FrontendPlan<T> &plan, u8 *region) {
+    typedef FrontendPlan<T> P;
+    if (plan.buffers[P::OUTPUT].size == 0) {
+        THROW(std::runtime_error, "mfcc_spectrogram: plan has no output buffer");
+        return {};
+    }
+    Tensor<T, 2> res = plan.template matrix<T>(region, P::OUTPUT, plan.dct_filters, plan.chunks);
+    mfcc_spectrogram_into(res, signal, plan, region);
+    return res;
+}
+
+template<typename T, std::enable_if_t<std::is_same<T, simplify_t<T>>::value, int> = 0>
+Tensor<T, 2> mfcc_spectrogram_for_learning(Tensor<T, 1> &signal, const FrontendPlan<T> &plan, u8 *region) {
+    if ((i32)plan.fft_size <= 0) {
+        THROW(std::runtime_error, "mfcc_spectrogram_for_learning: input too small!");
+        return {};
+    }
+
+    Tensor<T, 2> s = mfcc_spectrogram(signal, plan, region);
+    normalize_for_learning(s);
     return s;
 }
+template<typename T, std::enable_if_t<std::is_same<T, simplify_t<T>>::value, int> = 0>
+void mfcc_spectrogram_for_learning_into(Tensor<T, 2> &res, Tensor<T, 1> &signal, const FrontendPlan<T> &plan, u8 *region) {
+    if ((i32)plan.fft_size <= 0) {
+        THROW(std::runtime_error, "mfcc_spectrogram_for_learning: input too small!");
+        return;
+    }
+
+    mfcc_spectrogram_into(res, signal, plan, region);
+    normalize_for_learning(res);
+}
+// the int8 variant needs the plan's own output buffer for the f32 features
+template<typename T, std::enable_if_t<std::is_same<T, simplify_t<T>>::value, int> = 0>
+void mfcc_spectrogram_for_learning_into(QTensor<i8, 2> &res, Tensor<T, 1> &signal, const FrontendPlan<T> &plan, u8 *region) {
+    if ((i32)plan.fft_size <= 0) {
+        THROW(std::runtime_error, "mfcc_spectrogram_for_learning: input too small!");
+        return;
+    }
+
+    Tensor<T, 2> s = mfcc_spectrogram(signal, plan, region);
+    normalize_for_learning_into(res, s);
+}
 
 #endif
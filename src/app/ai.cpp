@@ -1,11 +1,38 @@
-#include "../ai/util.h"
-#include "../ai/tf.h"
+#include "../ai/encoder.h"
+
+static Encoder encoder;
+static Status last_status = { nullptr };
 
 extern "C" {
-    void preprocess_and_encode(float *input, unsigned input_len, float sample_rate, float *output) {
-        Tensor<f32, 1> input_tensor { input, nullptr, input_len };
-        Tensor<f32, 2> prepped = mfcc_spectrogram_for_learning(input_tensor, (f32)sample_rate);
-        Tensor<f32, 1> res = inference(prepped);
-        for (u32 i = 0; i < res.dim<0>(); ++i) output[i] = res(i);
+    bool encode_init(unsigned input_len, float sample_rate) {
+        last_status = encoder.init(input_len, (f32)sample_rate);
+        if (!last_status.ok()) return false;
+#ifdef ZERO_HEAP
+        pool_seal(true);
+#endif
+        return true;
+    }
+
+    bool preprocess_and_encode(float *input, unsigned input_len, float sample_rate, float *output) {
+        last_status = encoder.encode(input, input_len, (f32)sample_rate, output, inference_output_size());
+        return last_status.ok();
+    }
+
+    const char *encode_last_error(void) {
+        return last_status.error;
+    }
+
+    void encode_trace(bool on) {
+        pool_trace(on);
+    }
+    void encode_trace_report(void (*emit)(const char *line)) {
+        pool_trace_report(emit);
+    }
+
+    void encode_profile(bool on) {
+        inference_profile(on);
+    }
+    void encode_profile_report(void (*emit)(const char *line)) {
+        inference_profile_report(emit);
     }
 }
@@ -1,6 +1,20 @@
 #ifndef A3EM_APP_AI_H
 #define A3EM_APP_AI_H
 
-void preprocess_and_encode(float *input, unsigned input_len, float sample_rate, float *output);
+#include <stdbool.h>
+
+// sets up every buffer for clips of this shape; in ZERO_HEAP builds nothing is allocated afterwards
+bool encode_init(unsigned input_len, float sample_rate);
+bool preprocess_and_encode(float *input, unsigned input_len, float sample_rate, float *output);
+// reason for the last failed call above, or null if it succeeded
+const char *encode_last_error(void);
+
+// per-stage allocation counts, bytes, peaks and lifetimes of everything allocated while tracing is on
+void encode_trace(bool on);
+void encode_trace_report(void (*emit)(const char *line));
+
+// per-op and per-op-type model latency over every encode while profiling is on
+void encode_profile(bool on);
+void encode_profile_report(void (*emit)(const char *line));
 
 #endif
@@ -4,6 +4,12 @@
 
 #include "ai.h"
 
+#if defined(TRACE_ALLOCATIONS) || defined(PROFILE_INFERENCE)
+static void print_line(const char *line) {
+   print("%s\n", line);
+}
+#endif
+
 int main(void) {
    setup_hardware();
 
@@ -13,10 +19,28 @@ int main(void) {
    system_enable_interrupts(true);
    print("All peripherals initialized!\n");
 
+   if (!encode_init(8000, 8000))
+      print("Failed to initialize the encoder: %s\n", encode_last_error());
+
    float buf[8000];
    for (unsigned i = 0; i < sizeof(buf) / sizeof(*buf); ++i) buf[i] = 0.0;
    float embed[16];
-   preprocess_and_encode(buf, sizeof(buf) / sizeof(*buf), 8000, embed);
+#ifdef TRACE_ALLOCATIONS
+   encode_trace(true);
+#endif
+#ifdef PROFILE_INFERENCE
+   encode_profile(true);
+#endif
+   if (!preprocess_and_encode(buf, sizeof(buf) / sizeof(*buf), 8000, embed))
+      print("Failed to encode: %s\n", encode_last_error());
+#ifdef TRACE_ALLOCATIONS
+   encode_trace(false);
+   encode_trace_report(print_line);
+#endif
+#ifdef PROFILE_INFERENCE
+   encode_profile(false);
+   encode_profile_report(print_line);
+#endif
    for (unsigned i = 0; i < sizeof(embed) / sizeof(*embed); ++i) {
       print(" -> ", i);
    }